@@ -0,0 +1,61 @@
+const { Notcurses, Plane, Visual, ncstrwidth, ncstrwidths, NCSCALE_STRETCH, NCBLIT_3x2 } = require('.')
+
+const WIDTH = 3840
+const HEIGHT = 2160
+const ITERATIONS = 20
+
+const nc = new Notcurses({ sink: 'memory', rows: 40, cols: 120 })
+const plane = new Plane(nc, { rows: 40, cols: 120 })
+
+const frame = new Uint8Array(WIDTH * HEIGHT * 4)
+for (let i = 0; i < frame.length; i++) frame[i] = (i * 31) & 0xff
+
+const results = [
+  bench('full resolution', () => new Visual(nc, frame, WIDTH, HEIGHT)),
+  bench('prescaled', () => new Visual(nc, frame, WIDTH, HEIGHT, { scaleTo: plane, blitter: NCBLIT_3x2 }))
+]
+
+nc.destroy()
+
+for (const { name, create, blit } of results) {
+  console.log(`${name}: create ${create.toFixed(2)}ms, blit ${blit.toFixed(2)}ms (avg of ${ITERATIONS})`)
+}
+
+const ROWS = 10000
+const cells = []
+for (let i = 0; i < ROWS; i++) cells.push(i % 4 === 0 ? `größe ${i} 日本` : `row ${i} status ok`)
+
+const widths = new Uint32Array(ROWS)
+
+let start = Date.now()
+for (let i = 0; i < ITERATIONS; i++) {
+  for (let j = 0; j < ROWS; j++) widths[j] = ncstrwidth(cells[j])
+}
+const single = (Date.now() - start) / ITERATIONS
+
+start = Date.now()
+for (let i = 0; i < ITERATIONS; i++) ncstrwidths(cells, widths)
+const batch = (Date.now() - start) / ITERATIONS
+
+console.log(`width of ${ROWS} cells: per call ${single.toFixed(2)}ms, batch ${batch.toFixed(2)}ms (avg of ${ITERATIONS})`)
+
+function bench (name, factory) {
+  let create = 0
+  let blit = 0
+
+  for (let i = 0; i < ITERATIONS; i++) {
+    let start = Date.now()
+    const visual = factory()
+    create += Date.now() - start
+
+    start = Date.now()
+    visual.blit(plane, NCSCALE_STRETCH, NCBLIT_3x2)
+    nc.render()
+    nc.readOutput()
+    blit += Date.now() - start
+
+    visual.destroy()
+  }
+
+  return { name, create: create / ITERATIONS, blit: blit / ITERATIONS }
+}
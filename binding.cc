@@ -3,43 +3,285 @@
 #include <cstdint>
 #include <js.h>
 #include <jstl.h>
+#include <stddef.h>
 #include <stdlib.h>
+#include <libdeflate.h>
+#include <string.h>
+#include <string>
+#include <unigbrk.h>
+#include <unistr.h>
+#include <unordered_map>
 
 #include <notcurses/notcurses.h>
 
+#ifndef _WIN32
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define BARE_NCVISUAL_SSE2
+#endif
+
 namespace {
 using input_callback_t = js_function_t<void, js_arraybuffer_t>;
 using resize_callback_t = js_function_t<void>;
+using render_callback_t = js_function_t<void, int>;
+using decode_callback_t = js_function_t<void, int, uint32_t, uint32_t>;
 } // namespace
 
+// geometry, cursor and style mirrored into the plane handle,
+// read by JS without a binding call. must match STATE_* in lib/plane.js
+typedef struct {
+  int32_t y;
+  int32_t x;
+  uint32_t dim_y;
+  uint32_t dim_x;
+  uint32_t cursor_y;
+  uint32_t cursor_x;
+  uint32_t styles;
+  uint32_t fchannel;
+  uint32_t bchannel;
+} bare_ncplane_state_t;
+
+typedef struct bare_ncplane_s {
+  ncplane *handle;
+  js_persistent_t<resize_callback_t> on_resize;
+
+  bare_ncplane_state_t state;
+
+  // follows the parent's size, see ncplane_resize_marginalized()
+  bool marginalized;
+
+  // resize callbacks raised off the loop thread are deferred
+  bool resize_pending;
+  struct bare_ncplane_s *resize_next;
+
+  // rendered frame that did not fit the caller's buffer
+  char *frame;
+  size_t frame_len;
+
+  // async render of this plane's pile, requested through this handle
+  uv_work_t render_req;
+  bool rendering;
+  int render_status;
+  js_persistent_t<render_callback_t> on_render;
+  struct bare_ncplane_s *render_next;
+
+  // handle the userptr points into, held until the plane is destroyed so
+  // planes found through notcurses resolve to the wrapper JS already has
+  js_persistent_t<js_arraybuffer_t> self;
+  struct bare_ncplane_s *prev;
+  struct bare_ncplane_s *next;
+} bare_ncplane_t;
+
+// blit result kept offscreen and reattached when the same
+// content is blitted with the same geometry and options again
+typedef struct bare_ncvisual_cache_entry_s {
+  uint64_t hash;
+  uint32_t rows;
+  uint32_t cols;
+  uint32_t celldimy;
+  uint32_t celldimx;
+  int scaling;
+  int blitter;
+  uint64_t flags;
+
+  size_t bytes;
+
+  // root of its own pile or a child of parent while displayed
+  ncplane *plane;
+  ncplane *parent;
+
+  struct bare_ncvisual_cache_entry_s *prev;
+  struct bare_ncvisual_cache_entry_s *next;
+} bare_ncvisual_cache_entry_t;
+
+// entries ordered from most to least recently used
+typedef struct {
+  bare_ncvisual_cache_entry_t *head;
+  bare_ncvisual_cache_entry_t *tail;
+  uint32_t entries;
+  size_t bytes;
+  size_t budget;
+
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+} bare_ncvisual_cache_t;
+
+// default memory budget of the bitmap cache
+#define BARE_NCVISUAL_CACHE_BUDGET (32 * 1024 * 1024)
+
 typedef struct {
   notcurses *handle;
 
   js_env_t *env;
   uv_poll_t input_poll;
   js_persistent_t<input_callback_t> on_input;
+  int input_mode;
+
+  // drained events of a single wake in batch mode
+  ncinput *input_batch;
+
+  // ring of ncinput records shared with JS in ring mode
+  js_persistent_t<js_arraybuffer_t> input_ring;
+  uint8_t *input_ring_data;
+  uint32_t input_ring_capacity;
+
+  // async render, the pile must not be mutated while in flight
+  uv_work_t render_req;
+  bool rendering;
+  int render_status;
+  js_persistent_t<render_callback_t> on_render;
+
+  // async pile renders on workers, whichever handle requested them
+  bare_ncplane_t *pile_renders;
+  uint32_t pile_renders_len;
+
+  // async blits on workers, their destinations must outlive them
+  struct bare_ncvisual_blit_s *blits;
+  uint32_t blits_len;
+
+  // coalesces render requests into one frame per interval, allocated
+  // on the first request and freed once libuv is done closing it
+  uv_timer_t *frame_timer;
+  uint64_t frame_interval;
+  uint64_t frame_last;
+  js_persistent_t<render_callback_t> on_frame;
+
+  // output redirected away from the controlling terminal
+  FILE *out;
+  char *sink_data;
+  size_t sink_len;
+
+  uv_thread_t loop_thread;
+  uv_mutex_t resize_lock;
+  bare_ncplane_t *resize_queue;
+
+  bare_ncvisual_cache_t bitmap_cache;
+
+  // handle returned by stdplane(), resynced after renders
+  bare_ncplane_t *stdplane;
+
+  // wrapped planes still alive
+  bare_ncplane_t *planes;
 } bare_notcurses_t;
 
+enum {
+  BARE_NOTCURSES_INPUT_EVENT = 0,
+  BARE_NOTCURSES_INPUT_BATCH = 1,
+  BARE_NOTCURSES_INPUT_RING = 2,
+};
+
+// input ring header: u32 head, tail, capacity, dropped followed by records.
+// native advances head, JS advances tail; both run on the loop thread.
+// capacity is a power of two so slots stay in sequence when the
+// free running counters wrap
 typedef struct {
-  ncinput handle;
-} bare_notcurses_input_event_t;
+  uint32_t head;
+  uint32_t tail;
+  uint32_t capacity;
+  uint32_t dropped;
+} bare_notcurses_input_ring_t;
+
+// upper bound of events delivered in one batch
+#define BARE_NOTCURSES_INPUT_BATCH_MAX 1024
 
 typedef struct {
-  ncplane *handle;
-  js_persistent_t<resize_callback_t> on_resize;
-} bare_ncplane_t;
+  ncinput handle;
+} bare_notcurses_input_event_t;
 
 typedef struct {
   ncvisual *handle;
   uint32_t width;
   uint32_t height;
   uint8_t bpp;
+  uint8_t format;
+  uint32_t stride;
+
+  // source geometry when downscaled before creating the ncvisual
+  uint32_t src_width;
+  uint32_t src_height;
+
+  // downscale target reused across updates
+  uint8_t *scaled;
+
+  // content hash for the bitmap cache, computed while the pixels are at
+  // hand so it always describes what the ncvisual holds
+  uint64_t hash;
+  uint64_t palette_hash;
 
   js_persistent_t<js_arraybuffer_t> data;
   uint32_t offset;
   uint32_t len;
+
+  // ncvisual in use by a worker, must not be updated or destroyed
+  bool blitting;
 } bare_ncvisual_t;
 
+typedef struct bare_ncvisual_blit_s {
+  uv_work_t req;
+
+  notcurses *nc;
+  bare_notcurses_t *owner;
+  struct bare_ncvisual_blit_s *next;
+  bare_ncvisual_t *visual;
+  bare_ncplane_t *staging;
+  ncplane *dst;
+  ncvisual_options opts;
+  int status;
+
+  js_env_t *env;
+  js_persistent_t<render_callback_t> on_done;
+} bare_ncvisual_blit_t;
+
+typedef struct {
+  uv_work_t req;
+
+  bare_ncvisual_t *visual;
+  const uint8_t *png;
+  size_t png_len;
+  int status;
+
+  js_env_t *env;
+  js_persistent_t<js_arraybuffer_t> source;
+  js_persistent_t<js_arraybuffer_t> handle;
+  js_persistent_t<decode_callback_t> on_done;
+} bare_ncvisual_decode_t;
+
+enum {
+  BARE_PNG_OK = 0,
+  BARE_PNG_MALFORMED = -1,
+  BARE_PNG_UNSUPPORTED = -2,
+};
+
+#define BARE_PNG_MAX_PIXELS (1ULL << 28)
+
+typedef struct {
+  uint32_t width;
+  uint32_t height;
+  uint8_t depth;
+  uint8_t color;
+
+  uint8_t palette[256][4];
+  uint32_t palette_len;
+
+  // tRNS color key of gray and truecolor images
+  bool has_key;
+  uint16_t key[3];
+
+  uint8_t *idat;
+  size_t idat_len;
+  size_t idat_cap;
+} bare_png_t;
+
 namespace {
 
 static void
@@ -51,6 +293,96 @@ rearm_poll(uv_poll_t *poll) {
   assert(err == 0);
 }
 
+static int
+drain_input_batch(bare_notcurses_t *nc, input_callback_t &callback) {
+  int err;
+
+  if (nc->input_batch == nullptr) {
+    nc->input_batch = reinterpret_cast<ncinput *>(malloc(sizeof(ncinput) * BARE_NOTCURSES_INPUT_BATCH_MAX));
+    assert(nc->input_batch != nullptr);
+  }
+
+  while (true) {
+    size_t count = 0;
+    int res = 0;
+
+    while (count < BARE_NOTCURSES_INPUT_BATCH_MAX) {
+      // $ man 3 notcurses_input
+      res = notcurses_get_nblock(nc->handle, &nc->input_batch[count]);
+      assert(res != (uint32_t) -1 && "INPUT ERROR");
+      if (res == 0) break;
+
+      count++;
+    }
+
+    if (count == 0) return 0;
+
+    // one buffer of fixed size ncinput records per delivery
+    js_arraybuffer_t batch;
+    err = js_create_arraybuffer(nc->env, std::span<ncinput>(nc->input_batch, count), batch);
+    assert(err == 0);
+
+    err = js_call_function_with_checkpoint(nc->env, callback, batch);
+    if (err) return err;
+
+    if (res == 0 || nc->on_input.empty()) return 0;
+  }
+}
+
+static int
+drain_input_ring(bare_notcurses_t *nc, input_callback_t &callback) {
+  int err;
+
+  auto ring = reinterpret_cast<bare_notcurses_input_ring_t *>(nc->input_ring_data);
+  auto records = reinterpret_cast<ncinput *>(nc->input_ring_data + sizeof(*ring));
+
+  js_arraybuffer_t ring_handle;
+  err = js_get_reference_value(nc->env, nc->input_ring, ring_handle);
+  assert(err == 0);
+
+  bool notify = false;
+
+  while (true) {
+    int res;
+
+    if (ring->head - ring->tail < nc->input_ring_capacity) {
+      // $ man 3 notcurses_input
+      res = notcurses_get_nblock(nc->handle, &records[ring->head & (nc->input_ring_capacity - 1)]);
+      assert(res != (uint32_t) -1 && "INPUT ERROR");
+      if (res == 0) break;
+
+      ring->head++;
+      notify = true;
+      continue;
+    }
+
+    // ring full, let JS consume before reading further
+    err = js_call_function_with_checkpoint(nc->env, callback, ring_handle);
+    if (err) return err;
+    if (nc->on_input.empty()) return 0;
+
+    notify = false;
+
+    if (ring->head - ring->tail < nc->input_ring_capacity) continue;
+
+    // nothing was consumed, discard the rest of this wake
+    while (true) {
+      ncinput discard;
+      res = notcurses_get_nblock(nc->handle, &discard);
+      assert(res != (uint32_t) -1 && "INPUT ERROR");
+      if (res == 0) break;
+
+      ring->dropped++;
+    }
+
+    break;
+  }
+
+  if (!notify) return 0;
+
+  return js_call_function_with_checkpoint(nc->env, callback, ring_handle);
+}
+
 static void
 on_poll(uv_poll_t *handle, int status, int events) {
   assert(status == 0 && "poll error");
@@ -72,6 +404,23 @@ on_poll(uv_poll_t *handle, int status, int events) {
   err = js_get_reference_value(nc->env, nc->on_input, callback);
   assert(err == 0);
 
+  if (nc->input_mode != BARE_NOTCURSES_INPUT_EVENT) {
+    if (nc->input_mode == BARE_NOTCURSES_INPUT_RING) {
+      err = drain_input_ring(nc, callback);
+    } else {
+      err = drain_input_batch(nc, callback);
+    }
+
+    int res = js_close_handle_scope(nc->env, scope);
+    assert(res == 0);
+
+    // input stopped or notcurses destroyed by handler
+    if (err == 0 && !nc->on_input.empty()) {
+      rearm_poll(&nc->input_poll);
+    }
+    return;
+  }
+
   bare_notcurses_input_event_t *event;
   js_arraybuffer_t input_handle;
 
@@ -105,6 +454,12 @@ stop_poll(bare_notcurses_t &nc) {
   assert(err == 0);
 
   nc.on_input.reset();
+
+  free(nc.input_batch);
+  nc.input_batch = nullptr;
+
+  nc.input_ring.reset();
+  nc.input_ring_data = nullptr;
 }
 
 static inline uint64_t
@@ -117,14 +472,123 @@ bnu64 (js_env_t *env, js_bigint_t bn) {
   return u;
 }
 
-static int
-on_plane_resize (ncplane *ncp) {
-  auto plane = reinterpret_cast<bare_ncplane_t *>(ncplane_userptr(ncp));
-  assert(plane->handle == ncp);
+// NUL terminated copy of a utf8 slice for APIs without a length
+// argument, the scratch memory is reused across calls.
+static const char *
+utf8_cstr(const uint8_t *data, size_t len) {
+  static thread_local char *scratch = nullptr;
+  static thread_local size_t scratch_len = 0;
+
+  if (len + 1 > scratch_len) {
+    size_t next = scratch_len ? scratch_len : 256;
+    while (next < len + 1) next *= 2;
+
+    scratch = reinterpret_cast<char *>(realloc(scratch, next));
+    assert(scratch != nullptr);
+
+    scratch_len = next;
+  }
+
+  memcpy(scratch, data, len);
+  scratch[len] = '\0';
+
+  return scratch;
+}
 
-  auto ctx = ncplane_notcurses(plane->handle);
+static const uint8_t *
+utf8_slice(js_env_t *env, js_arraybuffer_t data, uint32_t offset, uint32_t len) {
+  std::span<uint8_t> bytes;
+  int err = js_get_arraybuffer_info(env, data, bytes);
+  assert(err == 0);
+  assert(offset + len <= bytes.size() && "BUFFER SLICE");
+
+  return bytes.data() + offset;
+}
+
+static inline bare_notcurses_t *
+plane_notcurses(ncplane *ncp) {
+  auto ctx = ncplane_notcurses(ncp);
   auto stdplane = notcurses_stdplane(ctx);
-  auto nc = reinterpret_cast<bare_notcurses_t *>(ncplane_userptr(stdplane));
+  return reinterpret_cast<bare_notcurses_t *>(ncplane_userptr(stdplane));
+}
+
+// true while an async render of the pile holding n is on a worker.
+// piles are told apart by their top plane, which a render leaves in place
+static bool
+pile_rendering(bare_notcurses_t *nc, ncplane *n) {
+  ncplane *top = ncpile_top(n);
+
+  if (nc->rendering && top == ncpile_top(notcurses_stdplane(nc->handle))) return true;
+
+  for (auto p = nc->pile_renders; p; p = p->render_next) {
+    if (ncpile_top(p->handle) == top) return true;
+  }
+
+  return false;
+}
+
+static void
+plane_wrap(js_env_t *env, bare_notcurses_t *nc, bare_ncplane_t *plane, js_arraybuffer_t handle) {
+  int err = js_create_reference(env, handle, plane->self);
+  assert(err == 0);
+
+  plane->prev = nullptr;
+  plane->next = nc->planes;
+
+  if (nc->planes) nc->planes->prev = plane;
+  nc->planes = plane;
+}
+
+// the native plane is gone, its handle stays valid holding a null plane
+static void
+plane_unwrap(bare_notcurses_t *nc, bare_ncplane_t *plane) {
+  if (plane->prev) plane->prev->next = plane->next;
+  else if (nc->planes == plane) nc->planes = plane->next;
+
+  if (plane->next) plane->next->prev = plane->prev;
+
+  plane->prev = plane->next = nullptr;
+
+  plane->handle = nullptr;
+  plane->on_resize.reset();
+  plane->self.reset();
+
+  free(plane->frame);
+  plane->frame = nullptr;
+  plane->frame_len = 0;
+}
+
+static void
+sync_plane_state(bare_ncplane_t *plane) {
+  if (plane->handle == nullptr) return;
+
+  auto state = &plane->state;
+  int y, x;
+
+  ncplane_yx(plane->handle, &y, &x);
+  state->y = y;
+  state->x = x;
+
+  ncplane_dim_yx(plane->handle, &state->dim_y, &state->dim_x);
+  ncplane_cursor_yx(plane->handle, &state->cursor_y, &state->cursor_x);
+
+  state->styles = ncplane_styles(plane->handle);
+  state->fchannel = ncplane_fchannel(plane->handle);
+  state->bchannel = ncplane_bchannel(plane->handle);
+}
+
+// the standard plane follows the terminal size which is
+// picked up while rendering
+static void
+sync_stdplane_state(bare_notcurses_t *nc) {
+  if (nc->stdplane) sync_plane_state(nc->stdplane);
+}
+
+static int
+call_plane_resize(bare_notcurses_t *nc, bare_ncplane_t *plane) {
+  sync_plane_state(plane);
+
+  if (plane->on_resize.empty()) return 0;
 
   int err;
 
@@ -144,850 +608,4021 @@ on_plane_resize (ncplane *ncp) {
   return res;
 }
 
-} // namespace
+// installed on every wrapped plane so the state block follows
+// resizes and moves notcurses makes on its own, e.g. of children
+// during a terminal resize
+static int
+on_plane_resize (ncplane *ncp) {
+  auto plane = reinterpret_cast<bare_ncplane_t *>(ncplane_userptr(ncp));
+  assert(plane->handle == ncp);
 
-static js_object_t
-bare_notcurses_init(js_env_t *env, uint64_t flags) {
-  int err;
+  if (plane->marginalized) ncplane_resize_marginalized(ncp);
 
-  js_arraybuffer_t handle;
-  bare_notcurses_t *nc;
-  err = js_create_arraybuffer(env, nc, handle);
-  assert(err == 0);
+  auto nc = plane_notcurses(plane->handle);
 
-  memset(static_cast<void *>(nc), 0, sizeof(*nc));
+  uv_thread_t self = uv_thread_self();
 
-  FILE *fp = NULL;
+  if (uv_thread_equal(&self, &nc->loop_thread)) {
+    return call_plane_resize(nc, plane);
+  }
 
-  notcurses_options options = {
-    // .termtype = "xterm-256"
-    .loglevel = NCLOGLEVEL_ERROR,
-    .margin_t = 0,
-    .margin_r = 0,
-    .margin_b = 0,
-    .margin_l = 0,
-    .flags = flags
-  };
+  // rendering on a worker, synced and JS invoked once the frame is done
+  uv_mutex_lock(&nc->resize_lock);
 
-  nc->handle = notcurses_core_init(&options, fp);
-  nc->env = env;
-  nc->on_input.reset();
+  if (!plane->resize_pending) {
+    plane->resize_pending = true;
+    plane->resize_next = nc->resize_queue;
+    nc->resize_queue = plane;
+  }
 
-  ncplane *stdplane = notcurses_stdplane(nc->handle);
-  ncplane_set_userptr(stdplane, &*nc);
+  uv_mutex_unlock(&nc->resize_lock);
 
-  return handle;
+  return 0;
 }
 
 static void
-bare_notcurses_destroy(js_env_t *env, js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc) {
-  int err = 0;
+flush_plane_resize(bare_notcurses_t *nc) {
+  uv_mutex_lock(&nc->resize_lock);
 
-  stop_poll(*nc);
+  bare_ncplane_t *plane = nc->resize_queue;
+  nc->resize_queue = nullptr;
 
-  err = notcurses_stop(nc->handle);
-  assert(err == 0);
-}
+  uv_mutex_unlock(&nc->resize_lock);
 
-static int
-bare_notcurses_render(js_env_t *env, js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc) {
-  int err = notcurses_render(nc->handle);
-  assert(err == 0);
-  return err;
+  while (plane) {
+    bare_ncplane_t *next = plane->resize_next;
+
+    plane->resize_pending = false;
+    plane->resize_next = nullptr;
+
+    if (plane->handle) call_plane_resize(nc, plane);
+
+    plane = next;
+  }
 }
 
-static int
-bare_notcurses_check_pixel_support (
-  js_env_t *env,
-  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc
-) {
-  return notcurses_check_pixel_support(nc->handle);
+static void
+on_render_work(uv_work_t *req) {
+  auto nc = reinterpret_cast<bare_notcurses_t *>(req->data);
+
+  ncplane *stdplane = notcurses_stdplane(nc->handle);
+
+  int res = ncpile_render(stdplane);
+  if (res == 0) res = ncpile_rasterize(stdplane);
+
+  nc->render_status = res;
 }
 
 static void
-bare_notcurses_input_start(
-  js_env_t *env,
-  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc,
-  input_callback_t callback,
-  uint32_t miceEnable
-) {
-  assert(nc->on_input.empty() && "NOT INITIALIZED");
+on_render_done(uv_work_t *req, int status) {
+  assert(status == 0);
 
-  int err;
+  auto nc = reinterpret_cast<bare_notcurses_t *>(req->data);
 
-  uv_loop_t *loop;
-  err = js_get_env_loop(env, &loop);
-  assert(err == 0);
+  nc->rendering = false;
 
-  int poll_fd = notcurses_inputready_fd(nc->handle);
+  flush_plane_resize(nc);
+  sync_stdplane_state(nc);
 
-  if (miceEnable != NCMICE_NO_EVENTS) {
-    int res = notcurses_mice_enable(nc->handle, miceEnable);
-    assert(res == 0 && "MOUSE FAILED"); // TODO: silent fail
-  }
+  int err;
 
-  err = uv_poll_init(loop, &nc->input_poll, poll_fd);
+  js_handle_scope_t *scope;
+  err = js_open_handle_scope(nc->env, &scope);
   assert(err == 0);
 
-  nc->input_poll.data = nc;
-
-  err = js_create_reference(env, callback, nc->on_input);
+  render_callback_t callback;
+  err = js_get_reference_value(nc->env, nc->on_render, callback);
   assert(err == 0);
 
-  rearm_poll(&nc->input_poll);
-}
+  // released first, callback may request the next frame
+  nc->on_render.reset();
 
-static void
-bare_notcurses_input_stop(
-  js_env_t *env,
-  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc
-) {
-  stop_poll(*nc);
+  js_call_function_with_checkpoint(nc->env, callback, nc->render_status);
+
+  err = js_close_handle_scope(nc->env, scope);
+  assert(err == 0);
 }
 
-static js_arraybuffer_t
-bare_notcurses_stdplane(
-  js_env_t *env,
-  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc
-) {
-  int err;
+static void
+schedule_frame(bare_notcurses_t *nc, uint64_t delay);
 
-  bare_ncplane_t *plane;
-  js_arraybuffer_t handle;
-  err = js_create_arraybuffer(env, plane, handle);
+static void
+on_frame_timer(uv_timer_t *handle) {
+  auto nc = reinterpret_cast<bare_notcurses_t *>(handle->data);
+
+  // async frame or pile render in flight, try again next interval
+  if (nc->rendering || nc->pile_renders_len > 0) {
+    schedule_frame(nc, nc->frame_interval);
+    return;
+  }
+
+  int res = notcurses_render(nc->handle);
+
+  sync_stdplane_state(nc);
+
+  nc->frame_last = uv_now(handle->loop);
+
+  if (nc->on_frame.empty()) return;
+
+  int err;
+
+  js_handle_scope_t *scope;
+  err = js_open_handle_scope(nc->env, &scope);
   assert(err == 0);
 
-  plane->handle = notcurses_stdplane(nc->handle);
-  assert(plane->handle != NULL);
+  render_callback_t callback;
+  err = js_get_reference_value(nc->env, nc->on_frame, callback);
+  assert(err == 0);
 
-  return handle;
+  js_call_function_with_checkpoint(nc->env, callback, res);
+
+  err = js_close_handle_scope(nc->env, scope);
+  assert(err == 0);
 }
 
-static js_arraybuffer_t
-bare_ncplane_create(
+static void
+on_frame_timer_close(uv_handle_t *handle) {
+  free(handle);
+}
+
+static void
+schedule_frame(bare_notcurses_t *nc, uint64_t delay) {
+  int err = uv_timer_start(nc->frame_timer, on_frame_timer, delay, 0);
+  assert(err == 0);
+}
+
+static void
+cache_unlink(bare_ncvisual_cache_t *cache, bare_ncvisual_cache_entry_t *entry) {
+  if (entry->prev) entry->prev->next = entry->next;
+  else cache->head = entry->next;
+
+  if (entry->next) entry->next->prev = entry->prev;
+  else cache->tail = entry->prev;
+
+  entry->prev = entry->next = nullptr;
+}
+
+static void
+cache_push(bare_ncvisual_cache_t *cache, bare_ncvisual_cache_entry_t *entry) {
+  entry->prev = nullptr;
+  entry->next = cache->head;
+
+  if (cache->head) cache->head->prev = entry;
+  else cache->tail = entry;
+
+  cache->head = entry;
+}
+
+static void
+cache_remove(bare_ncvisual_cache_t *cache, bare_ncvisual_cache_entry_t *entry) {
+  cache_unlink(cache, entry);
+
+  cache->entries--;
+  cache->bytes -= entry->bytes;
+
+  ncplane_destroy(entry->plane);
+  delete entry;
+}
+
+// evicts least recently used entries until within budget,
+// results currently displayed are spared
+static void
+cache_evict(bare_ncvisual_cache_t *cache) {
+  auto entry = cache->tail;
+
+  while (entry && cache->bytes > cache->budget) {
+    auto prev = entry->prev;
+
+    if (entry->parent == nullptr) {
+      cache_remove(cache, entry);
+      cache->evictions++;
+    }
+
+    entry = prev;
+  }
+}
+
+static void
+cache_clear(bare_ncvisual_cache_t *cache) {
+  while (cache->head) cache_remove(cache, cache->head);
+}
+
+static bool
+plane_descends(ncplane *ncp, ncplane *ancestor) {
+  while (ncp != ancestor) {
+    auto parent = ncplane_parent(ncp);
+    if (parent == ncp) return false;
+    ncp = parent;
+  }
+
+  return true;
+}
+
+// true when ncp, or a descendant when family is set, is the
+// destination of an async blit in flight
+static bool
+blit_targets(bare_notcurses_t *nc, ncplane *ncp, bool family) {
+  for (auto blit = nc->blits; blit; blit = blit->next) {
+    if (blit->dst == ncp || (family && plane_descends(blit->dst, ncp))) return true;
+  }
+
+  return false;
+}
+
+// moves cached results displayed by ncp, or its descendants
+// when family is set, offscreen into their own piles
+static void
+cache_detach(bare_ncvisual_cache_t *cache, ncplane *ncp, bool family) {
+  for (auto entry = cache->head; entry; entry = entry->next) {
+    if (entry->parent == nullptr) continue;
+    if (entry->parent != ncp && !(family && plane_descends(entry->parent, ncp))) continue;
+
+    ncplane_reparent_family(entry->plane, entry->plane);
+    entry->parent = nullptr;
+  }
+}
+
+} // namespace
+
+static js_object_t
+bare_notcurses_init(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> parent,
-  int y,
-  int x,
+  uint64_t flags,
+  int32_t fd,
   uint32_t rows,
   uint32_t cols,
-  uint64_t flags,
-  uint32_t margin_b,
-  uint32_t margin_r,
-  std::optional<std::string> name,
-  std::optional<resize_callback_t> onresize
+  bool memory_sink
 ) {
   int err;
 
-  bare_ncplane_t *plane;
   js_arraybuffer_t handle;
-  err = js_create_arraybuffer(env, plane, handle);
+  bare_notcurses_t *nc;
+  err = js_create_arraybuffer(env, nc, handle);
   assert(err == 0);
 
-  ncplane_options options = {
-    .y = y,
-    .x = x,
-    .rows = rows,
-    .cols = cols,
-    .userptr = plane,
-    .name = nullptr,
-    .flags = flags,
-    .margin_b = margin_b,
-    .margin_r = margin_r
-  };
+  memset(static_cast<void *>(nc), 0, sizeof(*nc));
 
-  if (margin_r || margin_b) {
-    options.flags |= NCPLANE_OPTION_MARGINALIZED;
+  FILE *fp = NULL;
+
+#ifndef _WIN32
+  if (memory_sink) {
+    fp = open_memstream(&nc->sink_data, &nc->sink_len);
+    assert(fp != NULL && "MEMORY SINK");
+  } else if (fd >= 0) {
+    // geometry can only be forced onto a pty
+    if (rows && cols && isatty(fd)) {
+      struct winsize ws = {};
+      ws.ws_row = rows;
+      ws.ws_col = cols;
+
+      err = ioctl(fd, TIOCSWINSZ, &ws);
+      assert(err == 0);
+    }
+
+    fp = fdopen(dup(fd), "w");
+    assert(fp != NULL && "OUTPUT FD");
   }
+#else
+  assert(fd < 0 && !memory_sink && "UNSUPPORTED");
+#endif
 
-  if (name) {
-    options.name = name->c_str();
+  nc->out = fp;
+
+  notcurses_options options = {
+    // .termtype = "xterm-256"
+    .loglevel = NCLOGLEVEL_ERROR,
+    .margin_t = 0,
+    .margin_r = 0,
+    .margin_b = 0,
+    .margin_l = 0,
+    .flags = flags
+  };
+
+  nc->handle = notcurses_core_init(&options, fp);
+  nc->env = env;
+  nc->on_input.reset();
+  nc->loop_thread = uv_thread_self();
+
+  err = uv_mutex_init(&nc->resize_lock);
+  assert(err == 0);
+
+  nc->bitmap_cache.budget = BARE_NCVISUAL_CACHE_BUDGET;
+
+  ncplane *stdplane = notcurses_stdplane(nc->handle);
+  ncplane_set_userptr(stdplane, &*nc);
+
+  return handle;
+}
+
+static void
+bare_notcurses_destroy(js_env_t *env, js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc) {
+  int err = 0;
+
+  assert(!nc->rendering && nc->pile_renders_len == 0 && "RENDER IN FLIGHT");
+  assert(nc->blits_len == 0 && "BLIT IN FLIGHT");
+
+  stop_poll(*nc);
+
+  if (nc->frame_timer) {
+    // nc may be collected before the close completes
+    nc->frame_timer->data = nullptr;
+
+    uv_close(reinterpret_cast<uv_handle_t *>(nc->frame_timer), on_frame_timer_close);
+    nc->frame_timer = nullptr;
   }
 
-  if (onresize) {
-    err = js_create_reference(env, *onresize, plane->on_resize);
-    assert(err == 0);
-    options.resizecb = on_plane_resize;
+  nc->on_frame.reset();
+
+  cache_clear(&nc->bitmap_cache);
+
+  while (nc->planes) plane_unwrap(&*nc, nc->planes);
+
+  nc->stdplane = nullptr;
+
+  err = notcurses_stop(nc->handle);
+  assert(err == 0);
+
+  if (nc->out) {
+    fclose(nc->out);
+    nc->out = NULL;
   }
 
-  plane->handle = ncplane_create(parent->handle, &options);
+  free(nc->sink_data);
+  nc->sink_data = NULL;
 
-  return handle;
+  uv_mutex_destroy(&nc->resize_lock);
 }
 
-static int
-bare_ncplane_destroy(
+static js_arraybuffer_t
+bare_notcurses_read_sink(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
+  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc
 ) {
-  int err = ncplane_destroy(plane->handle);
+  int err;
+
+  if (nc->out) fflush(nc->out);
+
+  js_arraybuffer_t output;
+  err = js_create_arraybuffer(env, std::span<uint8_t>(reinterpret_cast<uint8_t *>(nc->sink_data), nc->sink_len), output);
   assert(err == 0);
 
-  plane->handle = nullptr;
-  plane->on_resize.reset();
+  // subsequent output overwrites from the start
+  if (nc->out && nc->sink_data) rewind(nc->out);
 
-  return err;
+  return output;
 }
 
 static int
-bare_ncplane_family_destroy(
-  js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
-) {
-  int err = ncplane_family_destroy(plane->handle);
+bare_notcurses_render(js_env_t *env, js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc) {
+  assert(!nc->rendering && nc->pile_renders_len == 0 && "RENDER IN FLIGHT");
+
+  int err = notcurses_render(nc->handle);
   assert(err == 0);
 
-  plane->handle = nullptr;
-  plane->on_resize.reset();
+  sync_stdplane_state(&*nc);
 
   return err;
 }
 
-#if 0
-static js_arraybuffer_t
-bare_ncplane_get_notcurses(
+static void
+bare_notcurses_render_async(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
+  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc,
+  render_callback_t callback
 ) {
-  auto nc = ncplane_notcurses(plane->handle);
-  auto stdplane = notcurses_stdplane(nc);
-  auto bare_nc = reinterpret_cast<bare_notcurses_t *>(ncplane_userptr(stdplane));
-}
-#endif
+  assert(!nc->rendering && nc->pile_renders_len == 0 && "RENDER IN FLIGHT");
 
-static js_object_t
-bare_ncplane_pixel_geom(
-  js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
-) {
   int err;
 
-  uint32_t pxy, pxx;
-  uint32_t celldimy, celldimx;
-  uint32_t maxbmapy, maxbmapx;
-
-  ncplane_pixel_geom(plane->handle, &pxy, &pxx, &celldimy, &celldimx, &maxbmapy, &maxbmapx);
-
-  js_object_t res;
-  err = js_create_object(env, res);
+  uv_loop_t *loop;
+  err = js_get_env_loop(env, &loop);
   assert(err == 0);
 
-#define V(sym) \
-  err = js_set_property(env, res, #sym, sym); \
+  err = js_create_reference(env, callback, nc->on_render);
   assert(err == 0);
 
-  V(pxy)
-  V(pxx)
-  V(celldimy)
-  V(celldimx)
-  V(maxbmapy)
-  V(maxbmapx)
-
-#undef V
+  nc->rendering = true;
+  nc->render_req.data = &*nc;
 
-  return res;
+  err = uv_queue_work(loop, &nc->render_req, on_render_work, on_render_done);
+  assert(err == 0);
 }
 
-static int32_t
-bare_ncplane_get_y(
+static void
+bare_notcurses_render_schedule(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
+  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc,
+  uint32_t interval,
+  std::optional<render_callback_t> onframe
 ) {
-  return ncplane_y(plane->handle);
-}
+  int err;
 
-static int32_t
-bare_ncplane_get_x(
-  js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
-) {
-  return ncplane_x(plane->handle);
-}
+  nc->frame_interval = interval;
+  nc->on_frame.reset();
 
-static uint32_t
-bare_ncplane_get_dim_y(
-  js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
-) {
-  return ncplane_dim_y(plane->handle);
+  if (onframe) {
+    err = js_create_reference(env, *onframe, nc->on_frame);
+    assert(err == 0);
+  }
 }
 
-static uint32_t
-bare_ncplane_get_dim_x(
+static void
+bare_notcurses_request_render(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
+  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc
 ) {
-  return ncplane_dim_x(plane->handle);
-}
+  int err;
 
-static uint32_t
-bare_ncplane_get_cursor_y(
-  js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
-) {
-  return ncplane_cursor_y(plane->handle);
+  assert(nc->frame_interval > 0 && "NOT SCHEDULED");
+
+  if (nc->frame_timer == nullptr) {
+    uv_loop_t *loop;
+    err = js_get_env_loop(env, &loop);
+    assert(err == 0);
+
+    nc->frame_timer = reinterpret_cast<uv_timer_t *>(malloc(sizeof(uv_timer_t)));
+    assert(nc->frame_timer != nullptr);
+
+    err = uv_timer_init(loop, nc->frame_timer);
+    assert(err == 0);
+
+    nc->frame_timer->data = &*nc;
+  }
+
+  // a frame is already pending
+  if (uv_is_active(reinterpret_cast<uv_handle_t *>(nc->frame_timer))) return;
+
+  uint64_t now = uv_now(nc->frame_timer->loop);
+  uint64_t next = nc->frame_last + nc->frame_interval;
+
+  schedule_frame(&*nc, next > now ? next - now : 0);
 }
 
+// ncstats fields in the order exposed to JS, see lib/notcurses.js
+#define BARE_NCSTATS_FIELDS(V) \
+  V(renders) \
+  V(writeouts) \
+  V(failed_renders) \
+  V(failed_writeouts) \
+  V(raster_bytes) \
+  V(raster_max_bytes) \
+  V(raster_min_bytes) \
+  V(render_ns) \
+  V(render_max_ns) \
+  V(render_min_ns) \
+  V(raster_ns) \
+  V(raster_max_ns) \
+  V(raster_min_ns) \
+  V(writeout_ns) \
+  V(writeout_max_ns) \
+  V(writeout_min_ns) \
+  V(cellelisions) \
+  V(cellemissions) \
+  V(fgelisions) \
+  V(fgemissions) \
+  V(bgelisions) \
+  V(bgemissions) \
+  V(defaultelisions) \
+  V(defaultemissions) \
+  V(refreshes) \
+  V(sprixelemissions) \
+  V(sprixelelisions) \
+  V(sprixelbytes) \
+  V(appsync_updates) \
+  V(input_errors) \
+  V(input_events) \
+  V(hpa_gratuitous) \
+  V(cell_geo_changes) \
+  V(pixel_geo_changes) \
+  V(fbbytes) \
+  V(planes)
+
 static uint32_t
-bare_ncplane_get_cursor_x(
+bare_notcurses_stats(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
+  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc,
+  js_arraybuffer_t target,
+  uint32_t offset,
+  bool reset
 ) {
-  return ncplane_cursor_x(plane->handle);
-}
+  int err;
 
-static uint32_t
-bare_ncplane_get_styles(
-  js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
-) {
-  return ncplane_styles(plane->handle);
+  std::span<uint8_t> data;
+  err = js_get_arraybuffer_info(env, target, data);
+  assert(err == 0);
+
+  ncstats stats;
+
+  if (reset) {
+    notcurses_stats_reset(nc->handle, &stats);
+  } else {
+    notcurses_stats(nc->handle, &stats);
+  }
+
+  uint32_t i = 0;
+
+#define V(field) \
+  i++;
+  BARE_NCSTATS_FIELDS(V)
+#undef V
+
+  assert(offset + i * sizeof(double) <= data.size() && "STATS SLICE");
+
+  auto out = reinterpret_cast<double *>(&data[offset]);
+  i = 0;
+
+#define V(field) \
+  out[i++] = static_cast<double>(stats.field);
+  BARE_NCSTATS_FIELDS(V)
+#undef V
+
+  return i;
 }
 
-static void
-bare_ncplane_set_styles(
+static int
+bare_notcurses_check_pixel_support (
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
-  uint32_t style_mask
+  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc
 ) {
-  ncplane_set_styles(plane->handle, style_mask & 0xFFFF);
+  return notcurses_check_pixel_support(nc->handle);
 }
 
-static std::optional<std::string>
-bare_ncplane_get_name(
+static void
+bare_notcurses_input_start(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
+  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc,
+  input_callback_t callback,
+  uint32_t miceEnable,
+  uint32_t mode,
+  std::optional<js_arraybuffer_t> ring
 ) {
-  char *tmp = ncplane_name(plane->handle);
-  if (!tmp) return std::nullopt;
+  assert(nc->on_input.empty() && "NOT INITIALIZED");
 
-  std::string name(tmp);
-  free(tmp);
+  int err;
 
-  return name;
+  uv_loop_t *loop;
+  err = js_get_env_loop(env, &loop);
+  assert(err == 0);
+
+  int poll_fd = notcurses_inputready_fd(nc->handle);
+
+  if (miceEnable != NCMICE_NO_EVENTS) {
+    int res = notcurses_mice_enable(nc->handle, miceEnable);
+    assert(res == 0 && "MOUSE FAILED"); // TODO: silent fail
+  }
+
+  err = uv_poll_init(loop, &nc->input_poll, poll_fd);
+  assert(err == 0);
+
+  nc->input_poll.data = nc;
+  nc->input_mode = mode;
+
+  if (mode == BARE_NOTCURSES_INPUT_RING) {
+    assert(ring && "RING REQUIRED");
+
+    std::span<uint8_t> data;
+    err = js_get_arraybuffer_info(env, *ring, data);
+    assert(err == 0);
+    assert(data.size() >= sizeof(bare_notcurses_input_ring_t) && "RING SIZE");
+
+    auto header = reinterpret_cast<bare_notcurses_input_ring_t *>(data.data());
+    assert(header->capacity > 0 && (header->capacity & (header->capacity - 1)) == 0 && "RING CAPACITY POW2");
+    assert(sizeof(*header) + header->capacity * sizeof(ncinput) <= data.size() && "RING SIZE");
+
+    err = js_create_reference(env, *ring, nc->input_ring);
+    assert(err == 0);
+
+    nc->input_ring_data = data.data();
+    nc->input_ring_capacity = header->capacity;
+  }
+
+  err = js_create_reference(env, callback, nc->on_input);
+  assert(err == 0);
+
+  rearm_poll(&nc->input_poll);
 }
 
 static void
-bare_ncplane_set_name(
+bare_notcurses_input_stop(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
-  std::string name
+  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc
 ) {
-  int err = ncplane_set_name(plane->handle, name.c_str());
+  stop_poll(*nc);
+}
+
+static js_arraybuffer_t
+bare_notcurses_stdplane(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc
+) {
+  int err;
+
+  js_arraybuffer_t handle;
+
+  if (nc->stdplane) {
+    err = js_get_reference_value(env, nc->stdplane->self, handle);
+    assert(err == 0);
+
+    return handle;
+  }
+
+  bare_ncplane_t *plane;
+  err = js_create_arraybuffer(env, plane, handle);
   assert(err == 0);
+
+  plane->handle = notcurses_stdplane(nc->handle);
+  assert(plane->handle != NULL);
+
+  sync_plane_state(plane);
+
+  // the userptr of the standard plane belongs to nc
+  plane_wrap(env, &*nc, plane, handle);
+
+  nc->stdplane = plane;
+
+  return handle;
 }
 
-static int
-bare_ncplane_resize_simple(
+static js_arraybuffer_t
+bare_ncplane_create(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
-  uint32_t height,
-  uint32_t width
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> parent,
+  int y,
+  int x,
+  uint32_t rows,
+  uint32_t cols,
+  uint64_t flags,
+  uint32_t margin_b,
+  uint32_t margin_r,
+  std::optional<std::string> name,
+  std::optional<resize_callback_t> onresize
 ) {
-  int err = ncplane_resize_simple(plane->handle, height, width);
+  int err;
+
+  bare_ncplane_t *plane;
+  js_arraybuffer_t handle;
+  err = js_create_arraybuffer(env, plane, handle);
   assert(err == 0);
 
-  return err;
+  ncplane_options options = {
+    .y = y,
+    .x = x,
+    .rows = rows,
+    .cols = cols,
+    .userptr = plane,
+    .name = nullptr,
+    .resizecb = on_plane_resize,
+    .flags = flags,
+    .margin_b = margin_b,
+    .margin_r = margin_r
+  };
+
+  if (margin_r || margin_b) {
+    options.flags |= NCPLANE_OPTION_MARGINALIZED;
+  }
+
+  if (name) {
+    options.name = name->c_str();
+  }
+
+  if (onresize) {
+    err = js_create_reference(env, *onresize, plane->on_resize);
+    assert(err == 0);
+  }
+
+  plane->handle = ncplane_create(parent->handle, &options);
+  plane->marginalized = options.flags & NCPLANE_OPTION_MARGINALIZED;
+
+  plane_wrap(env, plane_notcurses(parent->handle), plane, handle);
+
+  sync_plane_state(plane);
+
+  return handle;
 }
 
 static int
-bare_ncplane_move_yx(
+bare_ncplane_destroy(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
-  int32_t y,
-  int32_t x
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
 ) {
-  int err = ncplane_move_yx(plane->handle, y, x);
+  auto nc = plane_notcurses(plane->handle);
+
+  assert(!blit_targets(nc, plane->handle, false) && "BLIT IN FLIGHT");
+
+  // children are reparented, cached blits must not leak onto the parent
+  cache_detach(&nc->bitmap_cache, plane->handle, false);
+
+  int err = ncplane_destroy(plane->handle);
   assert(err == 0);
 
+  plane_unwrap(nc, &*plane);
+
   return err;
 }
 
+// parks a plane for reuse. like destroy, children move to the parent
+// and cached blits are dropped, the plane itself becomes the root of a
+// pile of its own so nothing of it is rendered
 static void
-bare_ncplane_erase(
+bare_ncplane_release(
   js_env_t *env,
   js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
 ) {
-  ncplane_erase(plane->handle);
-}
+  auto nc = plane_notcurses(plane->handle);
 
-static int
-bare_ncplane_set_base(
-  js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
-  std::string egc,
-  uint32_t style_mask,
-  js_bigint_t channels
-) {
-  assert(style_mask <= 0xFFFF && "uint16_t");
+  assert(!pile_rendering(nc, plane->handle) && "RENDER IN FLIGHT");
+  assert(!blit_targets(nc, plane->handle, false) && "BLIT IN FLIGHT");
 
-  auto c = bnu64(env, channels);
+  ncplane *n = plane->handle;
 
-  int err = ncplane_set_base(plane->handle, egc.c_str(), style_mask, c);
-  assert(err >= 0);
+  cache_detach(&plane_notcurses(n)->bitmap_cache, n, false);
 
-  return err;
+  ncplane_reparent(n, n);
+
+  plane->on_resize.reset();
+  plane->marginalized = false;
+
+  ncplane_set_base(n, "", 0, 0);
+  ncplane_set_styles(n, 0);
+  ncplane_set_channels(n, 0);
+  ncplane_erase(n);
+
+  sync_plane_state(&*plane);
 }
 
+// takes a released plane back into use under parent
 static int
-bare_ncplane_putstr_yx(
+bare_ncplane_acquire(
   js_env_t *env,
   js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> parent,
   int32_t y,
   int32_t x,
-  std::string value
+  uint32_t rows,
+  uint32_t cols
 ) {
-  return ncplane_putstr_yx(plane->handle, y, x, value.c_str());
-}
+  ncplane *n = plane->handle;
 
-static inline int
-str_to_nccell(ncplane *plane, nccell *cell, std::string &str, uint16_t style_mask, uint64_t channels) {
-  return nccell_prime(plane, cell, str.c_str(), style_mask, channels);
-}
+  unsigned dimy, dimx;
+  ncplane_dim_yx(n, &dimy, &dimx);
 
-static int
-bare_ncplane_vline(
-  js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
-  std::string egc,
-  uint32_t len
-) {
-  nccell c = NCCELL_TRIVIAL_INITIALIZER;
-  nccell_prime(plane->handle, &c, egc.c_str(), 0, 0);
+  int err = 0;
 
-  int res = ncplane_vline(plane->handle, &c, len);
-  nccell_release(plane->handle, &c);
+  if (dimy != rows || dimx != cols) {
+    // erased on release, nothing worth keeping
+    err = ncplane_resize(n, 0, 0, 0, 0, 0, 0, rows, cols);
+  }
 
-  return res;
-}
+  if (err == 0) {
+    ncplane_reparent(n, parent->handle);
 
-static int
-bare_ncplane_mergedown_simple(
-  js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> dst
-) {
- int err = ncplane_mergedown_simple(plane->handle, dst->handle);
- assert(err == 0);
- return err;
+    err = ncplane_move_yx(n, y, x);
+  }
+
+  sync_plane_state(&*plane);
+
+  return err;
 }
 
-static int
-bare_ncplane_perimeter_simple(
+static int32_t
+bare_ncpile_render_to_buffer(
   js_env_t *env,
   js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
-  int type,
-  uint32_t style_mask,
-  js_bigint_t channels,
-  uint32_t ctlword
+  js_arraybuffer_t target,
+  uint32_t offset,
+  uint32_t len,
+  bool render
 ) {
-  auto c = bnu64(env, channels);
   int err;
-  switch (type) {
-    default:
-    case 0:
-      err = ncplane_perimeter_rounded(plane->handle, style_mask, c, ctlword);
-      break;
-    case 1:
-      err = ncplane_perimeter_double(plane->handle, style_mask, c, ctlword);
-      break;
-  }
+
+  std::span<uint8_t> data;
+  err = js_get_arraybuffer_info(env, target, data);
   assert(err == 0);
-  return err;
-}
+  assert(offset + len <= data.size() && "BUFFER SLICE");
 
-static js_bigint_t
-bare_ncplane_get_channels(
-  js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
-) {
-  uint64_t c = ncplane_channels(plane->handle);
-  js_bigint_t res;
+  assert(!pile_rendering(plane_notcurses(plane->handle), plane->handle) && "RENDER IN FLIGHT");
 
-  int err = js_create_bigint(env, c, res);
-  assert(err == 0);
+  if (plane->frame == nullptr) {
+    if (render) {
+      err = ncpile_render(plane->handle);
+      if (err < 0) return INT32_MIN;
 
-  return res;
-}
+      sync_stdplane_state(plane_notcurses(plane->handle));
+    }
 
-static void
-bare_ncplane_set_channels(
-  js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
-  js_bigint_t channels
+    // $ man 3 notcurses_render
+    err = ncpile_render_to_buffer(plane->handle, &plane->frame, &plane->frame_len);
+    if (err < 0) return INT32_MIN;
+  }
+
+  // retained until called with a large enough buffer,
+  // returns the negated size required
+  if (plane->frame_len > len) {
+    return -static_cast<int32_t>(plane->frame_len);
+  }
+
+  int32_t written = static_cast<int32_t>(plane->frame_len);
+  memcpy(&data[offset], plane->frame, plane->frame_len);
+
+  free(plane->frame);
+  plane->frame = nullptr;
+  plane->frame_len = 0;
+
+  return written;
+}
+
+static js_arraybuffer_t
+bare_ncpile_create(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc,
+  uint32_t rows,
+  uint32_t cols,
+  std::optional<std::string> name,
+  std::optional<resize_callback_t> onresize
 ) {
-  auto c = bnu64(env, channels);
-  ncplane_set_channels(plane->handle, c);
+  int err;
+
+  bare_ncplane_t *plane;
+  js_arraybuffer_t handle;
+  err = js_create_arraybuffer(env, plane, handle);
+  assert(err == 0);
+
+  ncplane_options options = {
+    .y = 0,
+    .x = 0,
+    .rows = rows,
+    .cols = cols,
+    .userptr = plane,
+    .name = nullptr,
+    .resizecb = on_plane_resize,
+    .flags = 0
+  };
+
+  if (name) {
+    options.name = name->c_str();
+  }
+
+  if (onresize) {
+    err = js_create_reference(env, *onresize, plane->on_resize);
+    assert(err == 0);
+  }
+
+  plane->handle = ncpile_create(nc->handle, &options);
+  assert(plane->handle != nullptr);
+
+  plane_wrap(env, &*nc, plane, handle);
+
+  sync_plane_state(plane);
+
+  return handle;
 }
 
-static void
-bare_ncplane_move_top(
+namespace {
+
+// handle of the wrapper of n, planes notcurses created on its
+// own, such as blit results, are wrapped in a new one
+static js_arraybuffer_t
+plane_handle(js_env_t *env, ncplane *n) {
+  int err;
+
+  auto nc = plane_notcurses(n);
+
+  bare_ncplane_t *plane = n == notcurses_stdplane(nc->handle)
+                            ? nc->stdplane
+                            : reinterpret_cast<bare_ncplane_t *>(ncplane_userptr(n));
+
+  js_arraybuffer_t handle;
+
+  if (plane) {
+    err = js_get_reference_value(env, plane->self, handle);
+    assert(err == 0);
+
+    return handle;
+  }
+
+  err = js_create_arraybuffer(env, plane, handle);
+  assert(err == 0);
+
+  plane->handle = n;
+
+  sync_plane_state(plane);
+
+  return handle;
+}
+
+} // namespace
+
+static js_arraybuffer_t
+bare_ncpile_top(
   js_env_t *env,
   js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
 ) {
-  ncplane_move_top(plane->handle);
+  ncplane *top = ncpile_top(plane->handle);
+  assert(top != nullptr);
+
+  return plane_handle(env, top);
 }
 
-static void
-bare_ncplane_move_bottom(
+static js_arraybuffer_t
+bare_ncpile_bottom(
   js_env_t *env,
   js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
 ) {
-  ncplane_move_bottom(plane->handle);
+  ncplane *bottom = ncpile_bottom(plane->handle);
+  assert(bottom != nullptr);
+
+  return plane_handle(env, bottom);
+}
+
+static int
+bare_ncpile_render(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
+) {
+  assert(!pile_rendering(plane_notcurses(plane->handle), plane->handle) && "RENDER IN FLIGHT");
+
+  int res = ncpile_render(plane->handle);
+
+  sync_stdplane_state(plane_notcurses(plane->handle));
+
+  return res;
 }
 
 static bool
-bare_ncplane_reparent_family(
+bare_ncpile_rendering(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> new_parent
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
 ) {
-  auto res = ncplane_reparent_family(plane->handle, new_parent->handle);
-  return res != nullptr;
+  return pile_rendering(plane_notcurses(plane->handle), plane->handle);
 }
 
-static int
-bare_ncplane_cursor_move_yx(
+static uint32_t
+bare_notcurses_pile_renders(js_env_t *env, js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc) {
+  return nc->pile_renders_len;
+}
+
+static uint32_t
+bare_notcurses_blits(js_env_t *env, js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc) {
+  return nc->blits_len;
+}
+
+static bool
+bare_ncplane_blit_target(
   js_env_t *env,
   js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
-  int32_t y,
-  int32_t x
+  bool family
 ) {
-  return ncplane_cursor_move_yx(plane->handle, y, x);
+  return blit_targets(plane_notcurses(plane->handle), plane->handle, family);
 }
 
-static std::string
-bare_ncplane_contents(
+static int
+bare_ncpile_rasterize(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
-  int32_t begy,
-  int32_t begx,
-  int32_t leny,
-  int32_t lenx
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
 ) {
-  auto str = ncplane_contents(plane->handle, begy, begx, leny, lenx);
-  assert(str != nullptr);
+  assert(!pile_rendering(plane_notcurses(plane->handle), plane->handle) && "RENDER IN FLIGHT");
 
-  std::string text(str);
-  free(str);
+  return ncpile_rasterize(plane->handle);
+}
 
-  return text;
+namespace {
+
+static void
+on_pile_render_work(uv_work_t *req) {
+  auto plane = reinterpret_cast<bare_ncplane_t *>(req->data);
+
+  // distinct piles may be rendered concurrently, rasterizing may not
+  plane->render_status = ncpile_render(plane->handle);
 }
 
-static uint32_t
-bare_ncinput_get_id(
+static void
+on_pile_render_done(uv_work_t *req, int status) {
+  assert(status == 0);
+
+  auto plane = reinterpret_cast<bare_ncplane_t *>(req->data);
+  auto nc = plane_notcurses(plane->handle);
+
+  plane->rendering = false;
+
+  auto link = &nc->pile_renders;
+  while (*link != plane) link = &(*link)->render_next;
+  *link = plane->render_next;
+
+  plane->render_next = nullptr;
+  nc->pile_renders_len--;
+
+  flush_plane_resize(nc);
+  sync_stdplane_state(nc);
+
+  int err;
+
+  js_handle_scope_t *scope;
+  err = js_open_handle_scope(nc->env, &scope);
+  assert(err == 0);
+
+  render_callback_t callback;
+  err = js_get_reference_value(nc->env, plane->on_render, callback);
+  assert(err == 0);
+
+  plane->on_render.reset();
+
+  js_call_function_with_checkpoint(nc->env, callback, plane->render_status);
+
+  err = js_close_handle_scope(nc->env, scope);
+  assert(err == 0);
+}
+
+} // namespace
+
+static void
+bare_ncpile_render_async(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_notcurses_input_event_t, 1> event
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  render_callback_t callback
 ) {
-  return event->handle.id;
+  assert(!pile_rendering(plane_notcurses(plane->handle), plane->handle) && "RENDER IN FLIGHT");
+
+  int err;
+
+  uv_loop_t *loop;
+  err = js_get_env_loop(env, &loop);
+  assert(err == 0);
+
+  err = js_create_reference(env, callback, plane->on_render);
+  assert(err == 0);
+
+  auto nc = plane_notcurses(plane->handle);
+
+  plane->rendering = true;
+  plane->render_req.data = &*plane;
+  plane->render_next = nc->pile_renders;
+
+  nc->pile_renders = &*plane;
+  nc->pile_renders_len++;
+
+  err = uv_queue_work(loop, &plane->render_req, on_pile_render_work, on_pile_render_done);
+  assert(err == 0);
 }
 
 static int
-bare_ncinput_get_type(
+bare_ncplane_family_destroy(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_notcurses_input_event_t, 1> event
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
 ) {
-  return event->handle.evtype;
+  auto nc = plane_notcurses(plane->handle);
+
+  assert(!blit_targets(nc, plane->handle, true) && "BLIT IN FLIGHT");
+
+  cache_detach(&nc->bitmap_cache, plane->handle, true);
+
+  // wrappers of descendants are left holding a null plane as well
+  for (auto p = nc->planes; p;) {
+    auto next = p->next;
+
+    if (p != &*plane && plane_descends(p->handle, plane->handle)) plane_unwrap(nc, p);
+
+    p = next;
+  }
+
+  int err = ncplane_family_destroy(plane->handle);
+  assert(err == 0);
+
+  plane_unwrap(nc, &*plane);
+
+  return err;
 }
 
-static int
-bare_ncinput_get_y(
+#if 0
+static js_arraybuffer_t
+bare_ncplane_get_notcurses(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_notcurses_input_event_t, 1> event
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
 ) {
-  return event->handle.y;
+  auto nc = ncplane_notcurses(plane->handle);
+  auto stdplane = notcurses_stdplane(nc);
+  auto bare_nc = reinterpret_cast<bare_notcurses_t *>(ncplane_userptr(stdplane));
 }
+#endif
 
-static int
-bare_ncinput_get_x(
+static js_object_t
+bare_ncplane_pixel_geom(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_notcurses_input_event_t, 1> event
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
 ) {
-  return event->handle.x;
+  int err;
+
+  uint32_t pxy, pxx;
+  uint32_t celldimy, celldimx;
+  uint32_t maxbmapy, maxbmapx;
+
+  ncplane_pixel_geom(plane->handle, &pxy, &pxx, &celldimy, &celldimx, &maxbmapy, &maxbmapx);
+
+  js_object_t res;
+  err = js_create_object(env, res);
+  assert(err == 0);
+
+#define V(sym) \
+  err = js_set_property(env, res, #sym, sym); \
+  assert(err == 0);
+
+  V(pxy)
+  V(pxx)
+  V(celldimy)
+  V(celldimx)
+  V(maxbmapy)
+  V(maxbmapx)
+
+#undef V
+
+  return res;
 }
 
-static bool
-bare_ncpinput_get_mouse(
+static void
+bare_ncplane_set_styles(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_notcurses_input_event_t, 1> event
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  uint32_t style_mask
 ) {
-  return nckey_mouse_p(event->handle.id);
+  ncplane_set_styles(plane->handle, style_mask & 0xFFFF);
+
+  plane->state.styles = ncplane_styles(plane->handle);
 }
 
-static std::string
-bare_ncinput_get_utf8(
+static std::optional<std::string>
+bare_ncplane_get_name(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_notcurses_input_event_t, 1> event
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
 ) {
-  return std::string(event->handle.utf8);
+  char *tmp = ncplane_name(plane->handle);
+  if (!tmp) return std::nullopt;
+
+  std::string name(tmp);
+  free(tmp);
+
+  return name;
 }
 
-static int
-bare_ncinput_get_modifiers(
+static void
+bare_ncplane_set_name(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_notcurses_input_event_t, 1> event
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  std::string name
 ) {
-  return event->handle.modifiers;
+  int err = ncplane_set_name(plane->handle, name.c_str());
+  assert(err == 0);
 }
 
 static int
-bare_ncinput_get_ypx(
+bare_ncplane_resize_simple(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_notcurses_input_event_t, 1> event
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  uint32_t height,
+  uint32_t width
 ) {
-  return event->handle.ypx;
+  int err = ncplane_resize_simple(plane->handle, height, width);
+  assert(err == 0);
+
+  sync_plane_state(&*plane);
+
+  return err;
 }
 
 static int
-bare_ncinput_get_xpx(
+bare_ncplane_move_yx(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_notcurses_input_event_t, 1> event
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  int32_t y,
+  int32_t x
 ) {
-  return event->handle.xpx;
-}
+  int err = ncplane_move_yx(plane->handle, y, x);
+  assert(err == 0);
+
+  sync_plane_state(&*plane);
+
+  return err;
+}
+
+static void
+bare_ncplane_erase(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
+) {
+  ncplane_erase(plane->handle);
+
+  sync_plane_state(&*plane);
+}
+
+static int
+bare_ncplane_set_base(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  std::string egc,
+  uint32_t style_mask,
+  uint32_t fchannel,
+  uint32_t bchannel
+) {
+  assert(style_mask <= 0xFFFF && "uint16_t");
+
+  auto c = ncchannels_combine(fchannel, bchannel);
+
+  int err = ncplane_set_base(plane->handle, egc.c_str(), style_mask, c);
+  assert(err >= 0);
+
+  return err;
+}
+
+static int
+bare_ncplane_set_base_utf8(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  js_arraybuffer_t data,
+  uint32_t offset,
+  uint32_t len,
+  uint32_t style_mask,
+  uint32_t fchannel,
+  uint32_t bchannel
+) {
+  assert(style_mask <= 0xFFFF && "uint16_t");
+
+  auto egc = utf8_cstr(utf8_slice(env, data, offset, len), len);
+  auto c = ncchannels_combine(fchannel, bchannel);
+
+  int err = ncplane_set_base(plane->handle, egc, style_mask, c);
+  assert(err >= 0);
+
+  return err;
+}
+
+static int
+bare_ncplane_putstr_yx(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  int32_t y,
+  int32_t x,
+  std::string value
+) {
+  int res = ncplane_putstr_yx(plane->handle, y, x, value.c_str());
+
+  sync_plane_state(&*plane);
+
+  return res;
+}
+
+static int
+bare_ncplane_putnstr_yx(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  int32_t y,
+  int32_t x,
+  js_arraybuffer_t data,
+  uint32_t offset,
+  uint32_t len
+) {
+  auto str = reinterpret_cast<const char *>(utf8_slice(env, data, offset, len));
+
+  // bounded by len, no terminator needed
+  int res = ncplane_putnstr_yx(plane->handle, y, x, len, str);
+
+  sync_plane_state(&*plane);
+
+  return res;
+}
+
+namespace {
+
+// bounds the grapheme width cache, it is dropped wholesale when full
+#define BARE_NCSTRWIDTH_CACHE_MAX 4096
+
+// longer non ascii segments are measured without being cached
+#define BARE_NCSTRWIDTH_CACHE_SEGMENT 64
+
+typedef struct {
+  int32_t res;
+  int32_t width;
+} bare_ncstrwidth_t;
+
+static inline bool
+ascii_printable(uint8_t b) {
+  return b >= 0x20 && b < 0x7f;
+}
+
+// length of the leading run of printable ascii, one column per byte
+static inline size_t
+ascii_run(const uint8_t *p, size_t len) {
+  size_t i = 0;
+
+#if defined(BARE_NCVISUAL_SSE2)
+  // signed compare, bytes >= 0x80 are negative and fail the lower bound
+  __m128i lo = _mm_set1_epi8(0x1f);
+  __m128i hi = _mm_set1_epi8(0x7f);
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+    __m128i ok = _mm_and_si128(_mm_cmpgt_epi8(v, lo), _mm_cmplt_epi8(v, hi));
+
+    if (_mm_movemask_epi8(ok) != 0xffff) break;
+  }
+#elif defined(__ARM_NEON)
+  uint8x16_t lo = vdupq_n_u8(0x20);
+  uint8x16_t hi = vdupq_n_u8(0x7e);
+
+  for (; i + 16 <= len; i += 16) {
+    uint8x16_t v = vld1q_u8(p + i);
+    uint64x2_t ok = vreinterpretq_u64_u8(vandq_u8(vcgeq_u8(v, lo), vcleq_u8(v, hi)));
+
+    if ((vgetq_lane_u64(ok, 0) & vgetq_lane_u64(ok, 1)) != UINT64_MAX) break;
+  }
+#endif
+
+  while (i < len && ascii_printable(p[i])) i++;
+
+  return i;
+}
+
+static bare_ncstrwidth_t
+segment_width(const uint8_t *p, size_t len) {
+  static thread_local std::unordered_map<std::string, bare_ncstrwidth_t> cache;
+  static thread_local std::string key;
+
+  key.assign(reinterpret_cast<const char *>(p), len);
+
+  bool cacheable = len <= BARE_NCSTRWIDTH_CACHE_SEGMENT;
+
+  if (cacheable) {
+    auto it = cache.find(key);
+    if (it != cache.end()) return it->second;
+  }
+
+  int bytes;
+  bare_ncstrwidth_t w = {0, 0};
+
+  w.res = ncstrwidth(key.c_str(), &bytes, &w.width);
+
+  if (cacheable) {
+    if (cache.size() >= BARE_NCSTRWIDTH_CACHE_MAX) cache.clear();
+
+    cache.emplace(key, w);
+  }
+
+  return w;
+}
+
+// grapheme clusters never break inside a run of printable ascii and
+// only the last byte of a run may be extended by what follows, so the
+// text is split into ascii runs counted directly and short non ascii
+// segments measured by ncstrwidth() through the cache.
+static int32_t
+utf8_width(const uint8_t *p, size_t len, bool ignore_invalid) {
+  int32_t width = 0;
+  size_t i = 0;
+
+  while (i < len) {
+    size_t run = ascii_run(p + i, len - i);
+
+    if (i + run < len && run > 0) run--;
+
+    width += static_cast<int32_t>(run);
+    i += run;
+
+    if (i == len) break;
+
+    size_t end = i + 1;
+    while (end < len && !ascii_printable(p[end])) end++;
+
+    auto w = segment_width(p + i, end - i);
+
+    if (w.res < 0) return ignore_invalid ? width + w.width : -1;
+
+    width += w.res;
+    i = end;
+  }
+
+  return width;
+}
+
+} // namespace
+
+namespace {
+
+static inline bool
+regional_indicator(ucs4_t uc) {
+  return uc >= 0x1f1e6 && uc <= 0x1f1ff;
+}
+
+// length in bytes of the grapheme cluster at p, joining the same
+// sequences notcurses keeps in a single cell: zero width joiners
+// and regional indicator pairs on top of the libunistring breaks
+static size_t
+grapheme_len(const uint8_t *p, const uint8_t *end) {
+  ucs4_t prev;
+  size_t i = u8_mbtouc(&prev, p, end - p);
+  int indicators = regional_indicator(prev);
+
+  while (p + i < end) {
+    ucs4_t uc;
+    int n = u8_mbtouc(&uc, p + i, end - p - i);
+
+    if (regional_indicator(uc)) {
+      if (indicators == 2 || (indicators == 0 && prev != 0x200d)) break;
+      indicators++;
+    } else if (prev != 0x200d && uc_is_grapheme_break(prev, uc)) {
+      break;
+    }
+
+    prev = uc;
+    i += n;
+  }
+
+  return i;
+}
+
+// columns taken by the grapheme cluster at p, its length in bytes is
+// written to len. invalid sequences count as one column and are left
+// to notcurses
+static int
+grapheme_width(const uint8_t *p, const uint8_t *end, size_t *len) {
+  // printable ascii is only extended by a non ascii codepoint
+  if (ascii_printable(*p) && (p + 1 == end || p[1] < 0x80)) {
+    *len = 1;
+    return 1;
+  }
+
+  size_t n = grapheme_len(p, end);
+
+  *len = n;
+
+  auto w = segment_width(p, n);
+
+  return w.res < 0 ? 1 : w.res;
+}
+
+} // namespace
+
+// wraps and aligns utf8 text from column 0 of row y (-1 for the cursor
+// row), returns the columns written or -1 when the plane ran out of room.
+// rows laid out and bytes consumed are written to result as u32, rows
+// scrolled out of a scrolling plane included
+static int
+bare_ncplane_puttext(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  int32_t y,
+  uint32_t align,
+  js_arraybuffer_t data,
+  uint32_t offset,
+  uint32_t len,
+  js_arraybuffer_t result,
+  uint32_t result_offset
+) {
+  int err;
+
+  std::span<uint8_t> result_data;
+  err = js_get_arraybuffer_info(env, result, result_data);
+  assert(err == 0);
+  assert(result_offset + 2 * sizeof(uint32_t) <= result_data.size() && "RESULT SLICE");
+
+  ncplane *n = plane->handle;
+
+  unsigned rows, cols;
+  ncplane_dim_yx(n, &rows, &cols);
+
+  unsigned row = y;
+  if (y < 0) ncplane_cursor_yx(n, &row, nullptr);
+
+  bool scrolling = ncplane_scrolling_p(n);
+
+  const uint8_t *text = utf8_slice(env, data, offset, len);
+  const uint8_t *end = text + len;
+  const uint8_t *p = text;
+
+  uint32_t laid = 0;
+  int written = 0;
+
+  while (p < end) {
+    if (row >= rows) {
+      if (!scrolling) {
+        written = -1;
+        break;
+      }
+
+      // a newline on the last row scrolls, or grows an autogrow plane
+      ncplane_cursor_move_yx(n, rows - 1, 0);
+      ncplane_putchar(n, '\n');
+
+      ncplane_cursor_yx(n, &row, nullptr);
+      ncplane_dim_yx(n, &rows, &cols);
+    }
+
+    // longest run of grapheme clusters that fits, remembering the
+    // last space a full row can be broken at
+    const uint8_t *q = p;
+    const uint8_t *space = nullptr;
+    int width = 0;
+    int space_width = 0;
+
+    while (q < end && *q != '\n') {
+      size_t cp;
+      int w = grapheme_width(q, end, &cp);
+
+      // zero width clusters stay on the row they follow
+      if (w > 0 && width + w > int(cols)) break;
+
+      if (*q == ' ' && q > p && q[-1] != ' ') {
+        space = q;
+        space_width = width;
+      }
+
+      width += w;
+      q += cp;
+    }
+
+    const uint8_t *stop = q;
+    const uint8_t *next = q;
+
+    if (q < end && *q != '\n') {
+      if (*q == ' ') {
+        // the word ends exactly at the edge, break at the space itself
+      } else if (space) {
+        stop = next = space;
+        width = space_width;
+      } else if (q == p) {
+        // a glyph wider than the plane is dropped
+        size_t cp;
+        grapheme_width(q, end, &cp);
+        next = q + cp;
+      }
+
+      while (next < end && *next == ' ') next++;
+    }
+
+    if (next < end && *next == '\n') next++;
+
+    if (stop > p) {
+      int x = align == NCALIGN_UNALIGNED ? 0 : ncplane_halign(n, static_cast<ncalign_e>(align), width);
+      int res = ncplane_putnstr_yx(n, row, x, stop - p, reinterpret_cast<const char *>(p));
+
+      if (res < 0) {
+        written = -1;
+        break;
+      }
+
+      written += res;
+    }
+
+    laid++;
+    row++;
+    p = next;
+  }
+
+  // text ending in a line break leaves the cursor on a fresh row
+  if (written >= 0 && len > 0 && end[-1] == '\n') {
+    if (row < rows) {
+      ncplane_cursor_move_yx(n, row, 0);
+    } else if (scrolling) {
+      ncplane_cursor_move_yx(n, rows - 1, 0);
+      ncplane_putchar(n, '\n');
+    }
+  }
+
+  auto out = reinterpret_cast<uint32_t *>(&result_data[result_offset]);
+  out[0] = laid;
+  out[1] = static_cast<uint32_t>(p - text);
+
+  sync_plane_state(&*plane);
+
+  return written;
+}
+
+static inline int
+str_to_nccell(ncplane *plane, nccell *cell, std::string &str, uint16_t style_mask, uint64_t channels) {
+  return nccell_prime(plane, cell, str.c_str(), style_mask, channels);
+}
+
+static int
+plane_vline(bare_ncplane_t *plane, const char *egc, uint32_t len, uint32_t style_mask, uint64_t channels) {
+  nccell c = NCCELL_TRIVIAL_INITIALIZER;
+  nccell_prime(plane->handle, &c, egc, style_mask, channels);
+
+  int res = ncplane_vline(plane->handle, &c, len);
+  nccell_release(plane->handle, &c);
+
+  sync_plane_state(plane);
+
+  return res;
+}
+
+static int
+bare_ncplane_vline(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  std::string egc,
+  uint32_t len,
+  uint32_t style_mask,
+  uint32_t fchannel,
+  uint32_t bchannel
+) {
+  return plane_vline(&*plane, egc.c_str(), len, style_mask, ncchannels_combine(fchannel, bchannel));
+}
+
+static int
+bare_ncplane_vline_utf8(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  js_arraybuffer_t data,
+  uint32_t offset,
+  uint32_t bytes,
+  uint32_t len,
+  uint32_t style_mask,
+  uint32_t fchannel,
+  uint32_t bchannel
+) {
+  auto egc = utf8_cstr(utf8_slice(env, data, offset, bytes), bytes);
+
+  return plane_vline(&*plane, egc, len, style_mask, ncchannels_combine(fchannel, bchannel));
+}
+
+static int
+bare_ncplane_mergedown_simple(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> dst
+) {
+ int err = ncplane_mergedown_simple(plane->handle, dst->handle);
+ assert(err == 0);
+ return err;
+}
+
+static int
+bare_ncplane_perimeter_simple(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  int type,
+  uint32_t style_mask,
+  uint32_t fchannel,
+  uint32_t bchannel,
+  uint32_t ctlword
+) {
+  auto c = ncchannels_combine(fchannel, bchannel);
+  int err;
+  switch (type) {
+    default:
+    case 0:
+      err = ncplane_perimeter_rounded(plane->handle, style_mask, c, ctlword);
+      break;
+    case 1:
+      err = ncplane_perimeter_double(plane->handle, style_mask, c, ctlword);
+      break;
+  }
+  assert(err == 0);
+
+  sync_plane_state(&*plane);
+
+  return err;
+}
+
+static uint32_t
+bare_ncplane_get_fchannel(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
+) {
+  return ncplane_fchannel(plane->handle);
+}
+
+static uint32_t
+bare_ncplane_get_bchannel(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
+) {
+  return ncplane_bchannel(plane->handle);
+}
+
+static void
+bare_ncplane_set_channels(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  uint32_t fchannel,
+  uint32_t bchannel
+) {
+  ncplane_set_channels(plane->handle, ncchannels_combine(fchannel, bchannel));
+
+  plane->state.fchannel = fchannel;
+  plane->state.bchannel = bchannel;
+}
+
+static void
+bare_ncplane_sync_state(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
+) {
+  sync_plane_state(&*plane);
+}
+
+static void
+bare_ncplane_move_top(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
+) {
+  ncplane_move_top(plane->handle);
+}
+
+static void
+bare_ncplane_move_bottom(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
+) {
+  ncplane_move_bottom(plane->handle);
+}
+
+static bool
+bare_ncplane_reparent_family(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> new_parent
+) {
+  auto res = ncplane_reparent_family(plane->handle, new_parent->handle);
+
+  sync_plane_state(&*plane);
+
+  return res != nullptr;
+}
+
+static int
+bare_ncplane_cursor_move_yx(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  int32_t y,
+  int32_t x
+) {
+  int res = ncplane_cursor_move_yx(plane->handle, y, x);
+
+  sync_plane_state(&*plane);
+
+  return res;
+}
+
+static std::string
+bare_ncplane_contents(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  int32_t begy,
+  int32_t begx,
+  int32_t leny,
+  int32_t lenx
+) {
+  auto str = ncplane_contents(plane->handle, begy, begx, leny, lenx);
+  assert(str != nullptr);
+
+  std::string text(str);
+  free(str);
+
+  return text;
+}
+
+static int32_t
+bare_ncplane_snapshot(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  uint32_t y,
+  uint32_t x,
+  uint32_t rows,
+  uint32_t cols,
+  js_arraybuffer_t text,
+  uint32_t text_offset,
+  uint32_t text_len,
+  js_arraybuffer_t offsets,
+  uint32_t offsets_offset,
+  std::optional<js_arraybuffer_t> styles,
+  uint32_t styles_offset,
+  std::optional<js_arraybuffer_t> channels,
+  uint32_t channels_offset
+) {
+  int err;
+
+  ncplane *n = plane->handle;
+
+  unsigned dimy, dimx;
+  ncplane_dim_yx(n, &dimy, &dimx);
+  assert(y + rows <= dimy && x + cols <= dimx && "REGION");
+
+  size_t cells = size_t(rows) * cols;
+
+  std::span<uint8_t> text_data;
+  err = js_get_arraybuffer_info(env, text, text_data);
+  assert(err == 0);
+  assert(text_offset + text_len <= text_data.size() && "TEXT SLICE");
+
+  std::span<uint8_t> offsets_data;
+  err = js_get_arraybuffer_info(env, offsets, offsets_data);
+  assert(err == 0);
+  assert(offsets_offset + (cells + 1) * sizeof(uint32_t) <= offsets_data.size() && "OFFSETS SLICE");
+
+  uint8_t *style_ptr = nullptr;
+  uint8_t *channels_ptr = nullptr;
+
+  if (styles) {
+    std::span<uint8_t> data;
+    err = js_get_arraybuffer_info(env, *styles, data);
+    assert(err == 0);
+    assert(styles_offset + cells * sizeof(uint16_t) <= data.size() && "STYLES SLICE");
+
+    style_ptr = &data[styles_offset];
+  }
+
+  if (channels) {
+    std::span<uint8_t> data;
+    err = js_get_arraybuffer_info(env, *channels, data);
+    assert(err == 0);
+    assert(channels_offset + cells * sizeof(uint64_t) <= data.size() && "CHANNELS SLICE");
+
+    channels_ptr = &data[channels_offset];
+  }
+
+  uint8_t *out = &text_data[text_offset];
+  auto out_offsets = reinterpret_cast<uint32_t *>(&offsets_data[offsets_offset]);
+
+  // keeps counting past the end of text to report the size required
+  size_t len = 0;
+  size_t i = 0;
+
+  nccell cell = NCCELL_TRIVIAL_INITIALIZER;
+
+  for (uint32_t row = 0; row < rows; row++) {
+    for (uint32_t col = 0; col < cols; col++, i++) {
+      out_offsets[i] = static_cast<uint32_t>(len);
+
+      uint16_t style_mask = 0;
+      uint64_t c = 0;
+
+      if (ncplane_at_yx_cell(n, y + row, x + col, &cell) >= 0) {
+        const char *egc = nccell_extended_gcluster(n, &cell);
+        size_t bytes = egc ? strlen(egc) : 0;
+
+        if (len + bytes <= text_len) memcpy(out + len, egc, bytes);
+        len += bytes;
+
+        style_mask = cell.stylemask;
+        c = cell.channels;
+
+        nccell_release(n, &cell);
+      }
+
+      if (style_ptr) memcpy(style_ptr + i * sizeof(style_mask), &style_mask, sizeof(style_mask));
+      if (channels_ptr) memcpy(channels_ptr + i * sizeof(c), &c, sizeof(c));
+    }
+  }
+
+  out_offsets[cells] = static_cast<uint32_t>(len);
+
+  // negated size required when text did not fit
+  if (len > text_len) return -static_cast<int32_t>(len);
+
+  return static_cast<int32_t>(len);
+}
+
+static int32_t
+bare_ncplane_put_cells(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  int32_t y,
+  int32_t x,
+  uint32_t rows,
+  uint32_t cols,
+  js_arraybuffer_t codepoints,
+  uint32_t codepoints_offset,
+  std::optional<js_arraybuffer_t> styles,
+  uint32_t styles_offset,
+  std::optional<js_arraybuffer_t> channels,
+  uint32_t channels_offset
+) {
+  int err;
+
+  size_t cells = size_t(rows) * cols;
+
+  std::span<uint8_t> cp_data;
+  err = js_get_arraybuffer_info(env, codepoints, cp_data);
+  assert(err == 0);
+  assert(codepoints_offset + cells * sizeof(uint32_t) <= cp_data.size() && "CODEPOINTS SLICE");
+
+  const uint8_t *style_ptr = nullptr;
+  if (styles) {
+    std::span<uint8_t> data;
+    err = js_get_arraybuffer_info(env, *styles, data);
+    assert(err == 0);
+    assert(styles_offset + cells * sizeof(uint16_t) <= data.size() && "STYLES SLICE");
+
+    style_ptr = &data[styles_offset];
+  }
+
+  const uint8_t *channels_ptr = nullptr;
+  if (channels) {
+    std::span<uint8_t> data;
+    err = js_get_arraybuffer_info(env, *channels, data);
+    assert(err == 0);
+    assert(channels_offset + cells * sizeof(uint64_t) <= data.size() && "CHANNELS SLICE");
+
+    channels_ptr = &data[channels_offset];
+  }
+
+  ncplane *n = plane->handle;
+  const uint8_t *cp_ptr = &cp_data[codepoints_offset];
+
+  // defaults to the plane's current style
+  uint16_t style_mask = ncplane_styles(n);
+  uint64_t c = ncplane_channels(n);
+
+  int32_t written = 0;
+  nccell cell = NCCELL_TRIVIAL_INITIALIZER;
+
+  for (size_t i = 0; i < cells; i++) {
+    uint32_t cp;
+    memcpy(&cp, cp_ptr + i * sizeof(cp), sizeof(cp));
+
+    // zero leaves cell untouched (trailing half of wide glyphs)
+    if (cp == 0) continue;
+
+    if (style_ptr) memcpy(&style_mask, style_ptr + i * sizeof(style_mask), sizeof(style_mask));
+    if (channels_ptr) memcpy(&c, channels_ptr + i * sizeof(c), sizeof(c));
+
+    if (nccell_load_ucs32(n, &cell, cp) < 0) continue;
+
+    cell.stylemask = style_mask;
+    cell.channels = c;
+
+    int row = static_cast<int>(i / cols);
+    int col = static_cast<int>(i % cols);
+
+    int res = ncplane_putc_yx(n, y + row, x + col, &cell);
+    if (res < 0) break;
+
+    written++;
+  }
+
+  nccell_release(n, &cell);
+
+  sync_plane_state(&*plane);
+
+  return written;
+}
+
+// opcodes of the packed command stream, see lib/command-buffer.js
+enum {
+  BARE_NCPLANE_OP_CURSOR_MOVE = 1,
+  BARE_NCPLANE_OP_SET_STYLES = 2,
+  BARE_NCPLANE_OP_SET_CHANNELS = 3,
+  BARE_NCPLANE_OP_PUTSTR = 4,
+  BARE_NCPLANE_OP_ERASE = 5,
+  BARE_NCPLANE_OP_PERIMETER = 6,
+};
+
+namespace {
+
+template <typename T>
+static inline bool
+read_op_arg(const uint8_t *&cursor, const uint8_t *end, T &value) {
+  if (cursor + sizeof(T) > end) return false;
+
+  memcpy(&value, cursor, sizeof(T));
+  cursor += sizeof(T);
+
+  return true;
+}
+
+// executes ops until the stream is exhausted or an op fails,
+// returns the amount of ops successfully executed, or -1 - i
+// when op i has an unknown opcode or is cut short
+static int32_t
+exec_plane_ops(ncplane *n, const uint8_t *cursor, const uint8_t *end) {
+  int32_t count = 0;
+
+  while (cursor < end) {
+    uint32_t op;
+    if (!read_op_arg(cursor, end, op)) return -1 - count;
+
+    int res = 0;
+
+    switch (op) {
+    case BARE_NCPLANE_OP_CURSOR_MOVE: {
+      int32_t y, x;
+      if (!read_op_arg(cursor, end, y) || !read_op_arg(cursor, end, x)) return -1 - count;
+
+      res = ncplane_cursor_move_yx(n, y, x);
+      break;
+    }
+
+    case BARE_NCPLANE_OP_SET_STYLES: {
+      uint32_t style_mask;
+      if (!read_op_arg(cursor, end, style_mask)) return -1 - count;
+
+      ncplane_set_styles(n, style_mask & 0xFFFF);
+      break;
+    }
+
+    case BARE_NCPLANE_OP_SET_CHANNELS: {
+      uint64_t channels;
+      if (!read_op_arg(cursor, end, channels)) return -1 - count;
+
+      ncplane_set_channels(n, channels);
+      break;
+    }
+
+    case BARE_NCPLANE_OP_PUTSTR: {
+      int32_t y, x;
+      uint32_t bytes;
+      if (!read_op_arg(cursor, end, y) || !read_op_arg(cursor, end, x) || !read_op_arg(cursor, end, bytes)) return -1 - count;
+
+      // text is padded to keep the following op aligned
+      uint32_t padded = (bytes + 3) & ~3u;
+      if (cursor + padded > end) return -1 - count;
+
+      res = ncplane_putnstr_yx(n, y, x, bytes, reinterpret_cast<const char *>(cursor));
+      cursor += padded;
+      break;
+    }
+
+    case BARE_NCPLANE_OP_ERASE:
+      ncplane_erase(n);
+      break;
+
+    case BARE_NCPLANE_OP_PERIMETER: {
+      uint32_t type, style_mask, ctlword;
+      uint64_t channels;
+      if (!read_op_arg(cursor, end, type) || !read_op_arg(cursor, end, style_mask) || !read_op_arg(cursor, end, channels) || !read_op_arg(cursor, end, ctlword)) return -1 - count;
+
+      if (type == 1) {
+        res = ncplane_perimeter_double(n, style_mask, channels, ctlword);
+      } else {
+        res = ncplane_perimeter_rounded(n, style_mask, channels, ctlword);
+      }
+      break;
+    }
+
+    default:
+      return -1 - count;
+    }
+
+    if (res < 0) break;
+
+    count++;
+  }
+
+  return count;
+}
+
+} // namespace
+
+static int32_t
+bare_ncplane_exec(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  js_arraybuffer_t ops,
+  uint32_t offset,
+  uint32_t len
+) {
+  int err;
+
+  std::span<uint8_t> data;
+  err = js_get_arraybuffer_info(env, ops, data);
+  assert(err == 0);
+  assert(offset + len <= data.size() && "BUFFER SLICE");
+
+  const uint8_t *cursor = &data[offset];
+  const uint8_t *end = cursor + len;
+
+  int32_t count = exec_plane_ops(plane->handle, cursor, end);
+
+  sync_plane_state(&*plane);
+
+  return count;
+}
+
+static uint32_t
+bare_ncchannels_get_fchannel(
+  js_env_t *env,
+  js_bigint_t channels
+) {
+  auto c = bnu64(env, channels);
+  return ncchannels_fchannel(c);
+}
+
+static uint32_t
+bare_ncchannels_get_bchannel(
+  js_env_t *env,
+  js_bigint_t channels
+) {
+  auto c = bnu64(env, channels);
+  return ncchannels_bchannel(c);
+}
+
+static js_bigint_t
+bare_ncchannels_combine(
+  js_env_t *env,
+  uint32_t fchan,
+  uint32_t bchan
+) {
+  auto c = ncchannels_combine(fchan, bchan);
+
+  js_bigint_t res;
+  int err = js_create_bigint(env, c, res);
+  assert(err == 0);
+
+  return res;
+}
+
+
+static js_bigint_t
+bare_ncchannels_reverse(
+  js_env_t *env,
+  js_bigint_t channels
+) {
+  auto c = bnu64(env, channels);
+
+  auto r = ncchannels_reverse(c);
+  js_bigint_t res;
+
+  int err = js_create_bigint(env, r, res);
+  assert(err == 0);
+
+  return res;
+}
+
+static uint32_t
+bare_ncchannel_get_rgb(
+  js_env_t *env,
+  uint32_t channel
+) {
+  return ncchannel_rgb(channel);
+}
+
+static uint32_t
+bare_ncchannel_set_rgb(
+  js_env_t *env,
+  uint32_t channel,
+  uint32_t rgb
+) {
+  ncchannel_set(&channel, rgb);
+  return channel;
+}
+
+static uint32_t
+bare_ncchannel_get_alpha(
+  js_env_t *env,
+  uint32_t channel
+) {
+  return ncchannel_alpha(channel);
+}
+
+static uint32_t
+bare_ncchannel_set_alpha(
+  js_env_t *env,
+  uint32_t channel,
+  uint32_t alpha
+) {
+  ncchannel_set_alpha(&channel, alpha);
+  return channel;
+}
+
+static uint32_t
+bare_ncchannel_get_palindex(
+  js_env_t *env,
+  uint32_t channel
+) {
+  return ncchannel_palindex(channel);
+}
+
+static uint32_t
+bare_ncchannel_set_palindex(
+  js_env_t *env,
+  uint32_t channel,
+  uint32_t index
+) {
+  ncchannel_set_palindex(&channel, index);
+  return channel;
+}
+
+static bool
+bare_ncchannel_is_default(
+  js_env_t *env,
+  uint32_t channel
+) {
+  return ncchannel_default_p(channel);
+}
+
+static bool
+bare_ncchannel_is_rgb(
+  js_env_t *env,
+  uint32_t channel
+) {
+  return ncchannel_rgb_p(channel);
+}
+
+static bool
+bare_ncchannel_is_indexed(
+  js_env_t *env,
+  uint32_t channel
+) {
+  return ncchannel_palindex_p(channel);
+}
+
+// bulk ops over [bg, fg] u32 pairs, must match OPS in lib/channels.js
+enum {
+  BARE_NCCHANNELS_SET_RGB = 0,
+  BARE_NCCHANNELS_SET_ALPHA = 1,
+  BARE_NCCHANNELS_SET_PALINDEX = 2,
+  BARE_NCCHANNELS_SET_DEFAULT = 3,
+  BARE_NCCHANNELS_REVERSE = 4,
+};
+
+// which channel of each pair an op applies to
+enum {
+  BARE_NCCHANNELS_FG = 1,
+  BARE_NCCHANNELS_BG = 2,
+};
+
+static void
+bare_ncchannels_transform(
+  js_env_t *env,
+  js_arraybuffer_t data,
+  uint32_t offset,
+  uint32_t count, // amount of pairs
+  uint32_t op,
+  uint32_t which,
+  uint32_t value
+) {
+  int err;
+
+  std::span<uint8_t> bytes;
+  err = js_get_arraybuffer_info(env, data, bytes);
+  assert(err == 0);
+  assert(offset % 4 == 0 && "ALIGNMENT");
+  assert(offset + size_t(count) * 8 <= bytes.size() && "BUFFER SLICE");
+
+  auto pairs = reinterpret_cast<uint32_t *>(&bytes[offset]);
+
+  if (op == BARE_NCCHANNELS_REVERSE) {
+    for (uint32_t i = 0; i < count; i++) {
+      uint64_t c = ncchannels_combine(pairs[i * 2 + 1], pairs[i * 2]);
+      c = ncchannels_reverse(c);
+
+      pairs[i * 2] = ncchannels_bchannel(c);
+      pairs[i * 2 + 1] = ncchannels_fchannel(c);
+    }
+
+    return;
+  }
+
+  // fg and bg share the same layout, treat the array as flat channels
+  uint32_t first = which & BARE_NCCHANNELS_BG ? 0 : 1;
+  uint32_t step = which == (BARE_NCCHANNELS_FG | BARE_NCCHANNELS_BG) ? 1 : 2;
+  uint32_t end = count * 2;
+
+  switch (op) {
+  case BARE_NCCHANNELS_SET_RGB:
+    for (uint32_t i = first; i < end; i += step) ncchannel_set(&pairs[i], value);
+    break;
+  case BARE_NCCHANNELS_SET_ALPHA:
+    for (uint32_t i = first; i < end; i += step) ncchannel_set_alpha(&pairs[i], value);
+    break;
+  case BARE_NCCHANNELS_SET_PALINDEX:
+    for (uint32_t i = first; i < end; i += step) ncchannel_set_palindex(&pairs[i], value);
+    break;
+  case BARE_NCCHANNELS_SET_DEFAULT:
+    for (uint32_t i = first; i < end; i += step) ncchannel_set_default(&pairs[i]);
+    break;
+  default:
+    assert(false && "OP");
+  }
+}
+
+// pixel formats accepted by visualCreate, see lib/visual.js
+enum {
+  BARE_NCVISUAL_RGBA = 0,
+  BARE_NCVISUAL_RGB = 1,
+  BARE_NCVISUAL_BGRA = 2,
+  BARE_NCVISUAL_PALIDX = 3,
+};
+
+namespace {
+
+static ncvisual *
+visual_from_pixels(
+  uint8_t format,
+  const uint8_t *pixels,
+  uint32_t height,
+  uint32_t stride,
+  uint32_t width,
+  const uint32_t *palette,
+  uint32_t palette_size
+) {
+  switch (format) {
+  case BARE_NCVISUAL_RGB:
+    return ncvisual_from_rgb_packed(pixels, height, stride, width, 0xff);
+
+  case BARE_NCVISUAL_BGRA:
+    return ncvisual_from_bgra(pixels, height, stride, width);
+
+  case BARE_NCVISUAL_PALIDX: {
+    assert(palette != nullptr && "PALETTE");
+    assert(palette_size <= 256 && "PALETTE SIZE");
+
+    // entries are read as ncchannels, which count as the default color
+    // unless NC_BGDEFAULT_MASK is set. palettes are given as 0xRRGGBB
+    uint32_t channels[256];
+
+    for (uint32_t i = 0; i < palette_size; i++) {
+      channels[i] = (palette[i] & NC_BG_RGB_MASK) | NC_BGDEFAULT_MASK | NCALPHA_OPAQUE;
+    }
+
+    return ncvisual_from_palidx(pixels, height, stride, width, palette_size, 1, channels);
+  }
+
+  default:
+    return ncvisual_from_rgba(pixels, height, stride, width);
+  }
+}
+
+// adds the channels of count consecutive 4 byte pixels to sum
+static inline void
+sum_pixels(const uint8_t *p, uint32_t count, uint32_t sum[4]) {
+  uint32_t i = 0;
+
+#if defined(BARE_NCVISUAL_SSE2)
+  __m128i zero = _mm_setzero_si128();
+  __m128i acc = _mm_setzero_si128();
+
+  for (; i + 4 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i * 4));
+
+    // pixels 0+2 and 1+3 as 16 bit channels
+    __m128i s = _mm_add_epi16(_mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero));
+
+    acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(s, zero));
+    acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(s, zero));
+  }
+
+  uint32_t lanes[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), acc);
+
+  for (int c = 0; c < 4; c++) sum[c] += lanes[c];
+#elif defined(__ARM_NEON)
+  uint32x4_t acc = vdupq_n_u32(0);
+
+  for (; i + 4 <= count; i += 4) {
+    uint8x16_t v = vld1q_u8(p + i * 4);
+
+    // pixels 0+2 and 1+3 as 16 bit channels
+    uint16x8_t s = vaddl_u8(vget_low_u8(v), vget_high_u8(v));
+
+    acc = vaddq_u32(acc, vaddl_u16(vget_low_u16(s), vget_high_u16(s)));
+  }
+
+  uint32_t lanes[4];
+  vst1q_u32(lanes, acc);
+
+  for (int c = 0; c < 4; c++) sum[c] += lanes[c];
+#endif
+
+  for (; i < count; i++) {
+    for (int c = 0; c < 4; c++) sum[c] += p[i * 4 + c];
+  }
+}
+
+// box filter downscale of 4 byte pixels, channel order is preserved
+static void
+downscale_box(
+  const uint8_t *src,
+  uint32_t src_height,
+  uint32_t src_stride,
+  uint32_t src_width,
+  uint8_t *dst,
+  uint32_t dst_height,
+  uint32_t dst_width
+) {
+  assert(dst_width <= src_width && dst_height <= src_height && "DOWNSCALE ONLY");
+
+  for (uint32_t dy = 0; dy < dst_height; dy++) {
+    uint32_t y0 = uint64_t(dy) * src_height / dst_height;
+    uint32_t y1 = uint64_t(dy + 1) * src_height / dst_height;
+    if (y1 <= y0) y1 = y0 + 1;
+
+    for (uint32_t dx = 0; dx < dst_width; dx++) {
+      uint32_t x0 = uint64_t(dx) * src_width / dst_width;
+      uint32_t x1 = uint64_t(dx + 1) * src_width / dst_width;
+      if (x1 <= x0) x1 = x0 + 1;
+
+      uint32_t sum[4] = {0, 0, 0, 0};
+
+      for (uint32_t y = y0; y < y1; y++) {
+        sum_pixels(src + size_t(y) * src_stride + size_t(x0) * 4, x1 - x0, sum);
+      }
+
+      uint32_t count = (x1 - x0) * (y1 - y0);
+      uint8_t *out = dst + (size_t(dy) * dst_width + dx) * 4;
+
+      for (int c = 0; c < 4; c++) out[c] = static_cast<uint8_t>((sum[c] + count / 2) / count);
+    }
+  }
+}
+
+#define BARE_NCVISUAL_HASH_SEED 0xcbf29ce484222325ULL
+
+static uint64_t
+hash_bytes(uint64_t h, const uint8_t *p, size_t len) {
+  const uint64_t prime = 0x100000001b3ULL;
+
+  size_t i = 0;
+
+  for (; i + 8 <= len; i += 8) {
+    uint64_t word;
+    memcpy(&word, p + i, 8);
+
+    h = (h ^ word) * prime;
+    h ^= h >> 29;
+  }
+
+  for (; i < len; i++) h = (h ^ p[i]) * prime;
+
+  return h;
+}
+
+// hash of the source pixels, palette and geometry of a visual
+static uint64_t
+hash_visual_pixels(bare_ncvisual_t *visual, const uint8_t *pixels) {
+  uint32_t geometry[] = {
+    visual->src_width,
+    visual->src_height,
+    visual->width,
+    visual->height,
+    visual->format,
+  };
+
+  uint64_t h = hash_bytes(visual->palette_hash, reinterpret_cast<const uint8_t *>(geometry), sizeof(geometry));
+
+  size_t row = size_t(visual->src_width) * visual->bpp;
+
+  for (uint32_t y = 0; y < visual->src_height; y++) {
+    h = hash_bytes(h, pixels + size_t(y) * visual->stride, row);
+  }
+
+  return h;
+}
+
+static inline uint32_t
+read_be32(const uint8_t *p) {
+  return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];
+}
+
+static int
+png_parse(const uint8_t *png, size_t len, bare_png_t *img) {
+  static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', 0x0d, 0x0a, 0x1a, 0x0a};
+
+  if (len < 8 || memcmp(png, signature, 8) != 0) return BARE_PNG_MALFORMED;
+
+  for (int i = 0; i < 256; i++) img->palette[i][3] = 0xff;
+
+  bool has_header = false;
+  size_t pos = 8;
+
+  while (true) {
+    if (len - pos < 12) return BARE_PNG_MALFORMED;
+
+    uint32_t chunk_len = read_be32(png + pos);
+    if (chunk_len > len - pos - 12) return BARE_PNG_MALFORMED;
+
+    const uint8_t *type = png + pos + 4;
+    const uint8_t *chunk = type + 4;
+
+    if (libdeflate_crc32(0, type, chunk_len + 4) != read_be32(chunk + chunk_len)) return BARE_PNG_MALFORMED;
+
+    pos += size_t(chunk_len) + 12;
+
+    if (memcmp(type, "IHDR", 4) == 0) {
+      if (chunk_len != 13 || has_header) return BARE_PNG_MALFORMED;
+
+      img->width = read_be32(chunk);
+      img->height = read_be32(chunk + 4);
+      img->depth = chunk[8];
+      img->color = chunk[9];
+
+      if (img->width == 0 || img->height == 0 || img->width > 0x7fffffff || img->height > 0x7fffffff) return BARE_PNG_MALFORMED;
+      if (chunk[10] != 0 || chunk[11] != 0) return BARE_PNG_MALFORMED;
+
+      // Adam7
+      if (chunk[12] != 0) return BARE_PNG_UNSUPPORTED;
+
+      bool valid;
+
+      switch (img->color) {
+      case 0:
+        valid = img->depth == 1 || img->depth == 2 || img->depth == 4 || img->depth == 8 || img->depth == 16;
+        break;
+      case 3:
+        valid = img->depth == 1 || img->depth == 2 || img->depth == 4 || img->depth == 8;
+        break;
+      case 2:
+      case 4:
+      case 6:
+        valid = img->depth == 8 || img->depth == 16;
+        break;
+      default:
+        valid = false;
+      }
+
+      if (!valid) return BARE_PNG_MALFORMED;
+
+      has_header = true;
+    } else if (!has_header) {
+      return BARE_PNG_MALFORMED;
+    } else if (memcmp(type, "PLTE", 4) == 0) {
+      if (chunk_len % 3 != 0 || chunk_len > 768) return BARE_PNG_MALFORMED;
+
+      img->palette_len = chunk_len / 3;
+
+      for (uint32_t i = 0; i < img->palette_len; i++) {
+        img->palette[i][0] = chunk[i * 3];
+        img->palette[i][1] = chunk[i * 3 + 1];
+        img->palette[i][2] = chunk[i * 3 + 2];
+      }
+    } else if (memcmp(type, "tRNS", 4) == 0) {
+      if (img->color == 3) {
+        if (chunk_len > 256) return BARE_PNG_MALFORMED;
+
+        for (uint32_t i = 0; i < chunk_len; i++) img->palette[i][3] = chunk[i];
+      } else if (img->color == 0 && chunk_len == 2) {
+        img->key[0] = uint16_t(chunk[0] << 8 | chunk[1]);
+        img->has_key = true;
+      } else if (img->color == 2 && chunk_len == 6) {
+        for (int c = 0; c < 3; c++) img->key[c] = uint16_t(chunk[c * 2] << 8 | chunk[c * 2 + 1]);
+        img->has_key = true;
+      }
+    } else if (memcmp(type, "IDAT", 4) == 0) {
+      if (img->idat_len + chunk_len > img->idat_cap) {
+        size_t cap = img->idat_cap ? img->idat_cap : 64 * 1024;
+        while (cap < img->idat_len + chunk_len) cap *= 2;
+
+        auto idat = reinterpret_cast<uint8_t *>(realloc(img->idat, cap));
+        if (idat == nullptr) return BARE_PNG_MALFORMED;
+
+        img->idat = idat;
+        img->idat_cap = cap;
+      }
+
+      memcpy(img->idat + img->idat_len, chunk, chunk_len);
+      img->idat_len += chunk_len;
+    } else if (memcmp(type, "IEND", 4) == 0) {
+      break;
+    } else if ((type[0] & 0x20) == 0) {
+      // unknown critical chunk
+      return BARE_PNG_UNSUPPORTED;
+    }
+  }
+
+  if (img->idat_len == 0) return BARE_PNG_MALFORMED;
+  if (img->color == 3 && img->palette_len == 0) return BARE_PNG_MALFORMED;
+
+  return BARE_PNG_OK;
+}
+
+static inline uint8_t
+png_paeth(int a, int b, int c) {
+  int p = a + b - c;
+  int pa = abs(p - a);
+  int pb = abs(p - b);
+  int pc = abs(p - c);
+
+  if (pa <= pb && pa <= pc) return a;
+  if (pb <= pc) return b;
+  return c;
+}
+
+// reverses the per row filters in place, rows keep their filter byte
+static bool
+png_unfilter(uint8_t *data, uint32_t height, size_t row_bytes, size_t bpp) {
+  const uint8_t *prev = nullptr;
+
+  for (uint32_t y = 0; y < height; y++) {
+    uint8_t *line = data + size_t(y) * (row_bytes + 1);
+    uint8_t *cur = line + 1;
+
+    switch (line[0]) {
+    case 0:
+      break;
+    case 1:
+      for (size_t i = bpp; i < row_bytes; i++) cur[i] += cur[i - bpp];
+      break;
+    case 2:
+      if (prev) {
+        for (size_t i = 0; i < row_bytes; i++) cur[i] += prev[i];
+      }
+      break;
+    case 3:
+      for (size_t i = 0; i < row_bytes; i++) {
+        int a = i >= bpp ? cur[i - bpp] : 0;
+        int b = prev ? prev[i] : 0;
+        cur[i] += uint8_t((a + b) >> 1);
+      }
+      break;
+    case 4:
+      for (size_t i = 0; i < row_bytes; i++) {
+        int a = i >= bpp ? cur[i - bpp] : 0;
+        int b = prev ? prev[i] : 0;
+        int c = prev && i >= bpp ? prev[i - bpp] : 0;
+        cur[i] += png_paeth(a, b, c);
+      }
+      break;
+    default:
+      return false;
+    }
+
+    prev = cur;
+  }
+
+  return true;
+}
+
+static inline uint16_t
+png_sample(const uint8_t *line, uint8_t depth, size_t index) {
+  switch (depth) {
+  case 16:
+    return uint16_t(line[index * 2] << 8 | line[index * 2 + 1]);
+  case 8:
+    return line[index];
+  default: {
+    size_t bit = index * depth;
+    int shift = 8 - depth - int(bit & 7);
+    return (line[bit >> 3] >> shift) & ((1 << depth) - 1);
+  }
+  }
+}
+
+static inline uint8_t
+png_to_8bit(uint16_t value, uint8_t depth) {
+  switch (depth) {
+  case 16:
+    return value >> 8;
+  case 8:
+    return value;
+  default:
+    return value * 255 / ((1 << depth) - 1);
+  }
+}
+
+static void
+png_to_rgba(const bare_png_t *img, const uint8_t *data, size_t row_bytes, uint8_t *rgba) {
+  uint32_t width = img->width;
+  uint8_t depth = img->depth;
+
+  for (uint32_t y = 0; y < img->height; y++) {
+    const uint8_t *line = data + size_t(y) * (row_bytes + 1) + 1;
+    uint8_t *out = rgba + size_t(y) * width * 4;
+
+    // already in the target layout
+    if (img->color == 6 && depth == 8) {
+      memcpy(out, line, size_t(width) * 4);
+      continue;
+    }
+
+    for (uint32_t x = 0; x < width; x++, out += 4) {
+      switch (img->color) {
+      case 0: {
+        uint16_t g = png_sample(line, depth, x);
+        out[0] = out[1] = out[2] = png_to_8bit(g, depth);
+        out[3] = img->has_key && g == img->key[0] ? 0 : 0xff;
+        break;
+      }
+      case 2: {
+        uint16_t r = png_sample(line, depth, size_t(x) * 3);
+        uint16_t g = png_sample(line, depth, size_t(x) * 3 + 1);
+        uint16_t b = png_sample(line, depth, size_t(x) * 3 + 2);
+        out[0] = png_to_8bit(r, depth);
+        out[1] = png_to_8bit(g, depth);
+        out[2] = png_to_8bit(b, depth);
+        out[3] = img->has_key && r == img->key[0] && g == img->key[1] && b == img->key[2] ? 0 : 0xff;
+        break;
+      }
+      case 3: {
+        // out of range indices are opaque black
+        uint16_t i = png_sample(line, depth, x);
+        if (i < img->palette_len) {
+          memcpy(out, img->palette[i], 4);
+        } else {
+          out[0] = out[1] = out[2] = 0;
+          out[3] = 0xff;
+        }
+        break;
+      }
+      case 4:
+        out[0] = out[1] = out[2] = png_to_8bit(png_sample(line, depth, size_t(x) * 2), depth);
+        out[3] = png_to_8bit(png_sample(line, depth, size_t(x) * 2 + 1), depth);
+        break;
+      case 6:
+        for (int c = 0; c < 4; c++) out[c] = png_to_8bit(png_sample(line, depth, size_t(x) * 4 + c), depth);
+        break;
+      }
+    }
+  }
+}
+
+// decodes a non interlaced png into tightly packed rgba
+static int
+png_decode(const uint8_t *png, size_t len, uint8_t **res, uint32_t *width, uint32_t *height) {
+  bare_png_t img = {};
+
+  int status = png_parse(png, len, &img);
+
+  if (status != BARE_PNG_OK) {
+    free(img.idat);
+    return status;
+  }
+
+  // keeps the rgba result addressable
+  if (uint64_t(img.width) * img.height > BARE_PNG_MAX_PIXELS) {
+    free(img.idat);
+    return BARE_PNG_UNSUPPORTED;
+  }
+
+  static const uint8_t channels[] = {1, 0, 3, 1, 2, 0, 4};
+
+  size_t bits = size_t(channels[img.color]) * img.depth;
+  size_t row_bytes = (size_t(img.width) * bits + 7) / 8;
+  size_t bpp = bits < 8 ? 1 : bits / 8;
+  size_t raw_len = (row_bytes + 1) * img.height;
+
+  auto raw = reinterpret_cast<uint8_t *>(malloc(raw_len));
+
+  if (raw == nullptr) {
+    free(img.idat);
+    return BARE_PNG_MALFORMED;
+  }
+
+  libdeflate_decompressor *decompressor = libdeflate_alloc_decompressor();
+  assert(decompressor != nullptr);
+
+  libdeflate_result inflated = libdeflate_zlib_decompress(decompressor, img.idat, img.idat_len, raw, raw_len, nullptr);
+
+  libdeflate_free_decompressor(decompressor);
+
+  free(img.idat);
+
+  if (inflated != LIBDEFLATE_SUCCESS || !png_unfilter(raw, img.height, row_bytes, bpp)) {
+    free(raw);
+    return BARE_PNG_MALFORMED;
+  }
+
+  auto rgba = reinterpret_cast<uint8_t *>(malloc(size_t(img.width) * img.height * 4));
+
+  if (rgba == nullptr) {
+    free(raw);
+    return BARE_PNG_MALFORMED;
+  }
+
+  png_to_rgba(&img, raw, row_bytes, rgba);
+  free(raw);
+
+  *res = rgba;
+  *width = img.width;
+  *height = img.height;
+
+  return BARE_PNG_OK;
+}
+
+static ncvisual *
+visual_from_downscaled(
+  uint8_t format,
+  const uint8_t *pixels,
+  uint32_t src_height,
+  uint32_t src_stride,
+  uint32_t src_width,
+  uint32_t height,
+  uint32_t width
+) {
+  auto scaled = reinterpret_cast<uint8_t *>(malloc(size_t(width) * height * 4));
+  assert(scaled != nullptr);
+
+  downscale_box(pixels, src_height, src_stride, src_width, scaled, height, width);
+
+  ncvisual *res = visual_from_pixels(format, scaled, height, width * 4, width, nullptr, 0);
+  free(scaled);
+
+  return res;
+}
+
+// whether every index of a palidx image is below palette_size
+static bool
+palidx_in_range(const uint8_t *pixels, uint32_t height, uint32_t stride, uint32_t width, uint32_t palette_size) {
+  if (palette_size >= 256) return true;
+
+  for (uint32_t y = 0; y < height; y++) {
+    const uint8_t *row = pixels + size_t(y) * stride;
+
+    for (uint32_t x = 0; x < width; x++) {
+      if (row[x] >= palette_size) return false;
+    }
+  }
+
+  return true;
+}
+
+// writes pixels into an existing ncvisual of the same geometry,
+// nothing is allocated. palidx indices must be checked beforehand
+static void
+visual_write_pixels(
+  ncvisual *ncv,
+  uint8_t format,
+  const uint8_t *pixels,
+  uint32_t height,
+  uint32_t stride,
+  uint32_t width,
+  const uint32_t *palette,
+  uint32_t palette_size
+) {
+  int err;
+
+  switch (format) {
+  case BARE_NCVISUAL_RGB:
+    for (uint32_t y = 0; y < height; y++) {
+      const uint8_t *p = pixels + size_t(y) * stride;
+
+      for (uint32_t x = 0; x < width; x++, p += 3) {
+        err = ncvisual_set_yx(ncv, y, x, ncpixel(p[0], p[1], p[2]));
+        assert(err == 0);
+      }
+    }
+    break;
+
+  case BARE_NCVISUAL_BGRA:
+    for (uint32_t y = 0; y < height; y++) {
+      const uint8_t *p = pixels + size_t(y) * stride;
+
+      for (uint32_t x = 0; x < width; x++, p += 4) {
+        uint32_t px = ncpixel(p[2], p[1], p[0]);
+        ncpixel_set_a(&px, p[3]);
+
+        err = ncvisual_set_yx(ncv, y, x, px);
+        assert(err == 0);
+      }
+    }
+    break;
+
+  case BARE_NCVISUAL_PALIDX: {
+    assert(palette_size <= 256 && "PALETTE SIZE");
+
+    uint32_t colors[256];
+
+    for (uint32_t i = 0; i < palette_size; i++) {
+      uint32_t c = palette[i];
+      colors[i] = ncpixel((c >> 16) & 0xff, (c >> 8) & 0xff, c & 0xff);
+    }
+
+    for (uint32_t y = 0; y < height; y++) {
+      const uint8_t *row = pixels + size_t(y) * stride;
+
+      for (uint32_t x = 0; x < width; x++) {
+        err = ncvisual_set_yx(ncv, y, x, colors[row[x]]);
+        assert(err == 0);
+      }
+    }
+    break;
+  }
+
+  default:
+    for (uint32_t y = 0; y < height; y++) {
+      const uint8_t *p = pixels + size_t(y) * stride;
+
+      for (uint32_t x = 0; x < width; x++, p += 4) {
+        uint32_t px = ncpixel(p[0], p[1], p[2]);
+        ncpixel_set_a(&px, p[3]);
+
+        err = ncvisual_set_yx(ncv, y, x, px);
+        assert(err == 0);
+      }
+    }
+  }
+}
+
+} // namespace
+
+// resolves NCBLIT_DEFAULT the way blitting media with scale would
+static int32_t
+bare_ncvisual_media_defblitter(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc,
+  int32_t scale
+) {
+  return ncvisual_media_defblitter(nc->handle, static_cast<ncscale_e>(scale));
+}
+
+static std::optional<js_arraybuffer_t>
+bare_ncvisual_create(
+  js_env_t *env,
+  js_arraybuffer_t data,
+  uint32_t offset,
+  uint32_t len,
+  uint32_t width,
+  uint32_t height,
+  uint32_t bpp, // bytes per pixel
+  uint32_t format,
+  uint32_t stride, // bytes per row
+  std::optional<js_arraybuffer_t> palette,
+  uint32_t palette_offset,
+  uint32_t palette_size
+) {
+  int err;
+
+  js_arraybuffer_t handle;
+  bare_ncvisual_t *visual;
+
+  err = js_create_arraybuffer(env, visual, handle);
+  assert(err == 0);
+
+  // save ref to redraw on resize
+  err = js_create_reference(env, data, visual->data);
+  assert(err == 0);
+
+  if (stride == 0) stride = width * bpp;
+
+  visual->offset = offset;
+  visual->len = len;
+  visual->width = width;
+  visual->height = height;
+  visual->bpp = bpp;
+  visual->format = format;
+  visual->stride = stride;
+  visual->src_width = width;
+  visual->src_height = height;
+  visual->scaled = nullptr;
+
+  std::span<uint8_t> pixels;
+  err = js_get_arraybuffer_info(env, data, pixels);
+  assert(err == 0);
+  assert(offset + len <= pixels.size() && "BUFFER SLICE");
+  assert(stride >= width * bpp && "STRIDE");
+  assert(height == 0 || size_t(stride) * (height - 1) + width * bpp <= len && "PIXELS");
+
+  const uint32_t *colors = nullptr;
+
+  if (palette) {
+    std::span<uint8_t> entries;
+    err = js_get_arraybuffer_info(env, *palette, entries);
+    assert(err == 0);
+    assert(palette_offset + palette_size * sizeof(uint32_t) <= entries.size() && "PALETTE SLICE");
+
+    colors = reinterpret_cast<const uint32_t *>(&entries[palette_offset]);
+  }
+
+  visual->palette_hash = hash_bytes(BARE_NCVISUAL_HASH_SEED, reinterpret_cast<const uint8_t *>(colors), palette_size * sizeof(uint32_t));
+
+  visual->handle = visual_from_pixels(format, &pixels[offset], height, stride, width, colors, palette_size);
+
+  // rejected by notcurses, e.g. palette indices past palette_size
+  if (visual->handle == nullptr) {
+    visual->data.reset();
+    return std::nullopt;
+  }
+
+  visual->hash = hash_visual_pixels(visual, &pixels[offset]);
+
+  return handle;
+}
+
+static js_arraybuffer_t
+bare_ncvisual_create_scaled(
+  js_env_t *env,
+  js_arraybuffer_t data,
+  uint32_t offset,
+  uint32_t len,
+  uint32_t width,
+  uint32_t height,
+  uint32_t format,
+  uint32_t stride, // bytes per row
+  uint32_t dst_width,
+  uint32_t dst_height
+) {
+  int err;
+
+  assert((format == BARE_NCVISUAL_RGBA || format == BARE_NCVISUAL_BGRA) && "FORMAT");
+
+  js_arraybuffer_t handle;
+  bare_ncvisual_t *visual;
+
+  err = js_create_arraybuffer(env, visual, handle);
+  assert(err == 0);
+
+  // the source is not retained, only its downscaled copy is needed
+  if (stride == 0) stride = width * 4;
+
+  visual->offset = offset;
+  visual->len = len;
+  visual->width = dst_width;
+  visual->height = dst_height;
+  visual->bpp = 4;
+  visual->format = format;
+  visual->stride = stride;
+  visual->src_width = width;
+  visual->src_height = height;
+  visual->scaled = nullptr;
+  visual->palette_hash = BARE_NCVISUAL_HASH_SEED;
+
+  std::span<uint8_t> pixels;
+  err = js_get_arraybuffer_info(env, data, pixels);
+  assert(err == 0);
+  assert(offset + len <= pixels.size() && "BUFFER SLICE");
+  assert(stride >= width * 4 && "STRIDE");
+  assert(height == 0 || size_t(stride) * (height - 1) + width * 4 <= len && "PIXELS");
+
+  visual->handle = visual_from_downscaled(format, &pixels[offset], height, stride, width, dst_height, dst_width);
+  assert(visual->handle != nullptr);
+
+  visual->hash = hash_visual_pixels(visual, &pixels[offset]);
+
+  return handle;
+}
+
+// returns false, leaving the visual untouched, when a palette
+// index is past the palette
+static bool
+bare_ncvisual_update(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncvisual_t, 1> visual,
+  js_arraybuffer_t data,
+  uint32_t offset,
+  uint32_t len,
+  std::optional<js_arraybuffer_t> palette,
+  uint32_t palette_offset,
+  uint32_t palette_size
+) {
+  int err;
+
+  uint32_t width = visual->src_width;
+  uint32_t height = visual->src_height;
+
+  std::span<uint8_t> pixels;
+  err = js_get_arraybuffer_info(env, data, pixels);
+  assert(err == 0);
+  assert(offset + len <= pixels.size() && "BUFFER SLICE");
+  assert(height == 0 || size_t(visual->stride) * (height - 1) + width * visual->bpp <= len && "PIXELS");
+
+  const uint32_t *colors = nullptr;
+
+  if (palette) {
+    std::span<uint8_t> entries;
+    err = js_get_arraybuffer_info(env, *palette, entries);
+    assert(err == 0);
+    assert(palette_offset + palette_size * sizeof(uint32_t) <= entries.size() && "PALETTE SLICE");
+
+    colors = reinterpret_cast<const uint32_t *>(&entries[palette_offset]);
+  }
+
+  assert(!visual->blitting && "BLIT IN FLIGHT");
+  assert((visual->format != BARE_NCVISUAL_PALIDX || colors != nullptr) && "PALETTE");
+
+  if (visual->format == BARE_NCVISUAL_PALIDX && !palidx_in_range(&pixels[offset], height, visual->stride, width, palette_size)) {
+    return false;
+  }
+
+  // same geometry and format, pixels are written into the existing visual
+  if (width != visual->width || height != visual->height) {
+    if (visual->scaled == nullptr) {
+      visual->scaled = reinterpret_cast<uint8_t *>(malloc(size_t(visual->width) * visual->height * 4));
+      assert(visual->scaled != nullptr);
+    }
+
+    downscale_box(&pixels[offset], height, visual->stride, width, visual->scaled, visual->height, visual->width);
+
+    visual_write_pixels(visual->handle, visual->format, visual->scaled, visual->height, visual->width * 4, visual->width, nullptr, 0);
+  } else {
+    visual_write_pixels(visual->handle, visual->format, &pixels[offset], height, visual->stride, width, colors, palette_size);
+  }
+
+  visual->data.reset();
+
+  // downscaled visuals do not pin their full resolution source
+  if (visual->scaled == nullptr) {
+    err = js_create_reference(env, data, visual->data);
+    assert(err == 0);
+  }
+
+  visual->offset = offset;
+  visual->len = len;
+
+  if (palette) {
+    visual->palette_hash = hash_bytes(BARE_NCVISUAL_HASH_SEED, reinterpret_cast<const uint8_t *>(colors), palette_size * sizeof(uint32_t));
+  }
+
+  visual->hash = hash_visual_pixels(visual, &pixels[offset]);
+
+  return true;
+}
+
+static void
+bare_ncvisual_destroy(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_ncvisual_t, 1> visual
+) {
+  assert(!visual->blitting && "BLIT IN FLIGHT");
+
+  visual->data.reset();
+  ncvisual_destroy(visual->handle);
+
+  free(visual->scaled);
+  visual->scaled = nullptr;
+}
+
+static std::optional<js_arraybuffer_t>
+bare_ncvisual_blit(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc,
+  js_arraybuffer_span_of_t<bare_ncvisual_t, 1> visual,
+  std::optional<js_arraybuffer_span_of_t<bare_ncplane_t, 1>> dst,
+  int y,
+  int x,
+  int scaling,
+  int blitter,
+  uint64_t flags
+) {
+  ncvisual_options opts = {
+    .y = y,
+    .x = x,
+    .blitter = static_cast<ncblitter_e>(blitter),
+    .flags = flags,
+  };
+
+  //  .scaling = NCSCALE_STRETCH,
+  //  .blitter = NCBLIT_3x2, // Seems default
+
+  if (dst) {
+    opts.n = (*dst)->handle;
+    opts.scaling = static_cast<ncscale_e>(scaling);
+
+    ncplane *cplane = ncvisual_blit(nc->handle, visual->handle, &opts);
+    assert(cplane == (*dst)->handle);
+
+    return std::nullopt;
+  } else {
+    js_arraybuffer_t handle;
+    bare_ncplane_t *plane;
+
+    int err = js_create_arraybuffer(env, plane, handle);
+    assert(err == 0);
+
+    plane->handle = ncvisual_blit(nc->handle, visual->handle, &opts);
+    assert(plane->handle != nullptr);
+
+    ncplane_set_userptr(plane->handle, plane);
+    ncplane_set_resizecb(plane->handle, on_plane_resize);
+    plane_wrap(env, &*nc, plane, handle);
+
+    sync_plane_state(plane);
+
+    return handle;
+  }
+}
+
+// returns 1 when served from the cache, 0 on a miss
+// and -1 when the visual could not be blitted
+static int
+bare_ncvisual_blit_cached(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc,
+  js_arraybuffer_span_of_t<bare_ncvisual_t, 1> visual,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> dst,
+  int scaling,
+  int blitter,
+  uint64_t flags
+) {
+  assert(!visual->blitting && "BLIT IN FLIGHT");
+
+  auto cache = &nc->bitmap_cache;
+
+  uint64_t hash = visual->hash;
+
+  unsigned rows, cols;
+  ncplane_dim_yx(dst->handle, &rows, &cols);
+
+  uint32_t pxy, pxx, celldimy, celldimx, maxbmapy, maxbmapx;
+  ncplane_pixel_geom(dst->handle, &pxy, &pxx, &celldimy, &celldimx, &maxbmapy, &maxbmapx);
+
+  // whatever dst displayed before is replaced
+  cache_detach(cache, dst->handle, false);
+
+  bare_ncvisual_cache_entry_t *entry = cache->head;
+
+  // entries shown under another plane stay there, the same content on
+  // several planes gets one entry each
+  while (entry) {
+    if (
+      entry->parent == nullptr &&
+      entry->hash == hash &&
+      entry->rows == rows &&
+      entry->cols == cols &&
+      entry->celldimy == celldimy &&
+      entry->celldimx == celldimx &&
+      entry->scaling == scaling &&
+      entry->blitter == blitter &&
+      entry->flags == flags
+    ) break;
+
+    entry = entry->next;
+  }
+
+  bool hit = entry != nullptr;
+
+  if (hit) {
+    cache_unlink(cache, entry);
+    cache_push(cache, entry);
+
+    cache->hits++;
+  } else {
+    ncplane_options options = {
+      .y = 0,
+      .x = 0,
+      .rows = rows,
+      .cols = cols,
+      .name = "blit",
+      .flags = 0
+    };
+
+    ncplane *plane = ncpile_create(nc->handle, &options);
+    assert(plane != nullptr);
+
+    ncvisual_options opts = {
+      .n = plane,
+      .scaling = static_cast<ncscale_e>(scaling),
+      .blitter = static_cast<ncblitter_e>(blitter),
+      .flags = flags,
+    };
+
+    // e.g. NCVISUAL_OPTION_NODEGRADE without pixel support
+    if (ncvisual_blit(nc->handle, visual->handle, &opts) != plane) {
+      ncplane_destroy(plane);
+
+      return -1;
+    }
+
+    entry = new bare_ncvisual_cache_entry_t();
+
+    entry->hash = hash;
+    entry->rows = rows;
+    entry->cols = cols;
+    entry->celldimy = celldimy;
+    entry->celldimx = celldimx;
+    entry->scaling = scaling;
+    entry->blitter = blitter;
+    entry->flags = flags;
+    entry->plane = plane;
+
+    // encoded bitmaps are roughly the size of their pixels, cells otherwise
+    entry->bytes = blitter == NCBLIT_PIXEL
+                     ? size_t(rows) * celldimy * cols * celldimx * 4
+                     : size_t(rows) * cols * sizeof(nccell);
+
+    cache_push(cache, entry);
+
+    cache->entries++;
+    cache->bytes += entry->bytes;
+    cache->misses++;
+  }
+
+  auto res = ncplane_reparent_family(entry->plane, dst->handle);
+  assert(res != nullptr);
+
+  entry->parent = dst->handle;
+
+  cache_evict(cache);
+
+  return hit ? 1 : 0;
+}
+
+static void
+bare_ncvisual_cache_budget(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc,
+  double budget
+) {
+  nc->bitmap_cache.budget = static_cast<size_t>(budget);
+
+  cache_evict(&nc->bitmap_cache);
+}
+
+static void
+bare_ncvisual_cache_clear(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc
+) {
+  cache_clear(&nc->bitmap_cache);
+}
+
+static js_object_t
+bare_ncvisual_cache_stats(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc
+) {
+  int err;
+
+  auto cache = &nc->bitmap_cache;
+
+  js_object_t res;
+  err = js_create_object(env, res);
+  assert(err == 0);
+
+#define V(name, value) \
+  err = js_set_property(env, res, name, static_cast<double>(value)); \
+  assert(err == 0);
+
+  V("entries", cache->entries)
+  V("bytes", cache->bytes)
+  V("budget", cache->budget)
+  V("hits", cache->hits)
+  V("misses", cache->misses)
+  V("evictions", cache->evictions)
+
+#undef V
+
+  return res;
+}
+
+namespace {
+
+static void
+on_blit_work(uv_work_t *req) {
+  auto blit = reinterpret_cast<bare_ncvisual_blit_t *>(req->data);
+
+  // scaling and bitmap encoding, the staging plane is the root
+  // of its own pile and thus safe to draw off the loop thread.
+  ncplane *res = ncvisual_blit(blit->nc, blit->visual->handle, &blit->opts);
+
+  blit->status = res == nullptr ? -1 : 0;
+}
+
+static void
+on_blit_done(uv_work_t *req, int status) {
+  assert(status == 0);
+
+  auto blit = reinterpret_cast<bare_ncvisual_blit_t *>(req->data);
+  auto env = blit->env;
+  auto nc = blit->owner;
+
+  blit->visual->blitting = false;
+
+  auto link = &nc->blits;
+  while (*link != blit) link = &(*link)->next;
+  *link = blit->next;
+
+  nc->blits_len--;
+
+  // destroying dst is refused while the blit is in flight
+  assert(ncplane_notcurses(blit->dst) == nc->handle);
+
+  if (blit->status == 0) {
+    // attach result to destination
+    auto res = ncplane_reparent_family(blit->staging->handle, blit->dst);
+    if (res == nullptr) blit->status = -1;
+  }
+
+  if (blit->status != 0) {
+    ncplane_destroy(blit->staging->handle);
+    plane_unwrap(nc, blit->staging);
+  }
+
+  int err;
+
+  js_handle_scope_t *scope;
+  err = js_open_handle_scope(env, &scope);
+  assert(err == 0);
+
+  render_callback_t callback;
+  err = js_get_reference_value(env, blit->on_done, callback);
+  assert(err == 0);
+
+  int res = blit->status;
+  delete blit;
+
+  js_call_function_with_checkpoint(env, callback, res);
+
+  err = js_close_handle_scope(env, scope);
+  assert(err == 0);
+}
+
+} // namespace
+
+static js_arraybuffer_t
+bare_ncvisual_blit_async(
+  js_env_t *env,
+  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc,
+  js_arraybuffer_span_of_t<bare_ncvisual_t, 1> visual,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> dst,
+  int scaling,
+  int blitter,
+  uint64_t flags,
+  render_callback_t callback
+) {
+  assert(!visual->blitting && "BLIT IN FLIGHT");
+
+  int err;
+
+  uv_loop_t *loop;
+  err = js_get_env_loop(env, &loop);
+  assert(err == 0);
+
+  js_arraybuffer_t handle;
+  bare_ncplane_t *staging;
+  err = js_create_arraybuffer(env, staging, handle);
+  assert(err == 0);
+
+  unsigned rows, cols;
+  ncplane_dim_yx(dst->handle, &rows, &cols);
+
+  ncplane_options options = {
+    .y = 0,
+    .x = 0,
+    .rows = rows,
+    .cols = cols,
+    .userptr = staging,
+    .name = "blit",
+    .resizecb = on_plane_resize,
+    .flags = 0
+  };
+
+  staging->handle = ncpile_create(nc->handle, &options);
+  assert(staging->handle != nullptr);
+
+  plane_wrap(env, &*nc, staging, handle);
+
+  auto blit = new bare_ncvisual_blit_t();
+
+  blit->req.data = blit;
+  blit->nc = nc->handle;
+  blit->owner = &*nc;
+  blit->visual = &*visual;
+  blit->staging = staging;
+  blit->dst = dst->handle;
+  blit->env = env;
+
+  blit->opts = {
+    .n = staging->handle,
+    .scaling = static_cast<ncscale_e>(scaling),
+    .blitter = static_cast<ncblitter_e>(blitter),
+    .flags = flags,
+  };
+
+  err = js_create_reference(env, callback, blit->on_done);
+  assert(err == 0);
+
+  visual->blitting = true;
+
+  blit->next = nc->blits;
+  nc->blits = blit;
+  nc->blits_len++;
+
+  err = uv_queue_work(loop, &blit->req, on_blit_work, on_blit_done);
+  assert(err == 0);
+
+  return handle;
+}
+
+namespace {
+
+static void
+on_decode_work(uv_work_t *req) {
+  auto decode = reinterpret_cast<bare_ncvisual_decode_t *>(req->data);
+  auto visual = decode->visual;
+
+  uint8_t *rgba;
+  uint32_t width, height;
+
+  decode->status = png_decode(decode->png, decode->png_len, &rgba, &width, &height);
+  if (decode->status != BARE_PNG_OK) return;
+
+  visual->width = visual->src_width = width;
+  visual->height = visual->src_height = height;
+  visual->bpp = 4;
+  visual->format = BARE_NCVISUAL_RGBA;
+  visual->stride = width * 4;
+  visual->scaled = nullptr;
+  visual->palette_hash = BARE_NCVISUAL_HASH_SEED;
+
+  // no pixels are retained in JS, hash while they are at hand
+  visual->hash = hash_visual_pixels(visual, rgba);
+
+  visual->handle = ncvisual_from_rgba(rgba, height, width * 4, width);
+  free(rgba);
+
+  if (visual->handle == nullptr) decode->status = BARE_PNG_MALFORMED;
+}
+
+static void
+on_decode_done(uv_work_t *req, int status) {
+  assert(status == 0);
+
+  auto decode = reinterpret_cast<bare_ncvisual_decode_t *>(req->data);
+  auto env = decode->env;
+  auto visual = decode->visual;
+
+  visual->blitting = false;
+
+  int err;
+
+  js_handle_scope_t *scope;
+  err = js_open_handle_scope(env, &scope);
+  assert(err == 0);
+
+  decode_callback_t callback;
+  err = js_get_reference_value(env, decode->on_done, callback);
+  assert(err == 0);
+
+  int res = decode->status;
+  uint32_t width = visual->width;
+  uint32_t height = visual->height;
+
+  delete decode;
+
+  js_call_function_with_checkpoint(env, callback, res, width, height);
+
+  err = js_close_handle_scope(env, scope);
+  assert(err == 0);
+}
+
+} // namespace
+
+static js_arraybuffer_t
+bare_ncvisual_decode_png(
+  js_env_t *env,
+  js_arraybuffer_t data,
+  uint32_t offset,
+  uint32_t len,
+  decode_callback_t callback
+) {
+  int err;
+
+  uv_loop_t *loop;
+  err = js_get_env_loop(env, &loop);
+  assert(err == 0);
+
+  std::span<uint8_t> png;
+  err = js_get_arraybuffer_info(env, data, png);
+  assert(err == 0);
+  assert(offset + len <= png.size() && "BUFFER SLICE");
+
+  js_arraybuffer_t handle;
+  bare_ncvisual_t *visual;
+  err = js_create_arraybuffer(env, visual, handle);
+  assert(err == 0);
+
+  auto decode = new bare_ncvisual_decode_t();
+
+  decode->req.data = decode;
+  decode->visual = visual;
+  decode->png = &png[offset];
+  decode->png_len = len;
+  decode->env = env;
+
+  // source and result must outlive the worker
+  err = js_create_reference(env, data, decode->source);
+  assert(err == 0);
+
+  err = js_create_reference(env, handle, decode->handle);
+  assert(err == 0);
+
+  err = js_create_reference(env, callback, decode->on_done);
+  assert(err == 0);
+
+  visual->blitting = true;
+
+  err = uv_queue_work(loop, &decode->req, on_decode_work, on_decode_done);
+  assert(err == 0);
+
+  return handle;
+}
+
+// scrollback of utf8 lines. line bytes are written front to back into
+// one arena, a line that would straddle its end starts over at the front
+// and the oldest lines it overlaps are dropped
+typedef struct {
+  uint64_t start; // absolute arena position
+  uint32_t len;
+} bare_nclog_line_t;
+
+typedef struct {
+  uint8_t *arena;
+  uint32_t arena_len;
+
+  bare_nclog_line_t *lines; // ring, oldest at first
+  uint32_t lines_len;
+  uint32_t first;
+  uint32_t count;
+
+  uint64_t head; // absolute write position
+
+  uint32_t scroll; // lines hidden below the window
+  bool dirty;
+
+  unsigned rows; // geometry last rendered into
+  unsigned cols;
+} bare_nclog_t;
+
+namespace {
+
+static inline bare_nclog_line_t *
+log_line(bare_nclog_t *log, uint32_t i) {
+  return &log->lines[(log->first + i) % log->lines_len];
+}
+
+static void
+log_push(bare_nclog_t *log, const uint8_t *data, uint32_t len) {
+  // keeps the start of lines longer than the arena
+  if (len > log->arena_len) len = log->arena_len;
+
+  uint64_t pos = log->head;
+  uint64_t wrap = pos % log->arena_len;
+
+  if (wrap + len > log->arena_len) pos += log->arena_len - wrap;
+
+  uint64_t end = pos + len;
+
+  // lines are ordered by start, the first survivor ends the scan
+  while (log->count > 0) {
+    auto oldest = log_line(log, 0);
+
+    if (log->count < log->lines_len && oldest->start + log->arena_len >= end) break;
+
+    log->first = (log->first + 1) % log->lines_len;
+    log->count--;
+  }
+
+  // evicting many short lines at once can leave scroll past the oldest
+  if (log->scroll >= log->count) log->scroll = log->count > 0 ? log->count - 1 : 0;
+
+  memcpy(log->arena + pos % log->arena_len, data, len);
+
+  *log_line(log, log->count++) = {pos, len};
 
-static js_arraybuffer_t
-bare_ncinput_get_eff_text(
-  js_env_t *env,
-  js_arraybuffer_span_of_t<bare_notcurses_input_event_t, 1> event
-) {
-  auto view = std::span<uint32_t>(event->handle.eff_text);
+  log->head = end;
 
-  js_arraybuffer_t buffer;
-  int err = js_create_arraybuffer(env, view, buffer);
-  assert(err == 0);
+  // a scrolled back window stays on the same lines
+  if (log->scroll > 0 && log->scroll < log->count - 1) log->scroll++;
 
-  return buffer;
+  log->dirty = true;
 }
 
-static uint32_t
-bare_ncchannels_get_fchannel(
-  js_env_t *env,
-  js_bigint_t channels
-) {
-  auto c = bnu64(env, channels);
-  return ncchannels_fchannel(c);
-}
+} // namespace
 
-static uint32_t
-bare_ncchannels_get_bchannel(
-  js_env_t *env,
-  js_bigint_t channels
-) {
-  auto c = bnu64(env, channels);
-  return ncchannels_bchannel(c);
-}
+static js_arraybuffer_t
+bare_nclog_create(js_env_t *env, uint32_t lines, uint32_t bytes) {
+  int err;
 
-static js_bigint_t
-bare_ncchannels_combine(
-  js_env_t *env,
-  uint32_t fchan,
-  uint32_t bchan
-) {
-  auto c = ncchannels_combine(fchan, bchan);
+  assert(lines > 0 && bytes > 0);
 
-  js_bigint_t res;
-  int err = js_create_bigint(env, c, res);
+  js_arraybuffer_t handle;
+  bare_nclog_t *log;
+
+  err = js_create_arraybuffer(env, log, handle);
   assert(err == 0);
 
-  return res;
-}
+  log->arena = reinterpret_cast<uint8_t *>(malloc(bytes));
+  assert(log->arena != nullptr);
 
+  log->lines = reinterpret_cast<bare_nclog_line_t *>(malloc(sizeof(bare_nclog_line_t) * lines));
+  assert(log->lines != nullptr);
 
-static js_bigint_t
-bare_ncchannels_reverse(
-  js_env_t *env,
-  js_bigint_t channels
-) {
-  auto c = bnu64(env, channels);
+  log->arena_len = bytes;
+  log->lines_len = lines;
+  log->first = 0;
+  log->count = 0;
+  log->head = 0;
+  log->scroll = 0;
+  log->dirty = true;
+  log->rows = 0;
+  log->cols = 0;
 
-  auto r = ncchannels_reverse(c);
-  js_bigint_t res;
+  return handle;
+}
 
-  int err = js_create_bigint(env, r, res);
-  assert(err == 0);
+static void
+bare_nclog_destroy(js_env_t *env, js_arraybuffer_span_of_t<bare_nclog_t, 1> log) {
+  free(log->arena);
+  free(log->lines);
 
-  return res;
+  log->arena = nullptr;
+  log->lines = nullptr;
 }
 
+// appends newline separated text, a trailing partial line counts as a
+// line, returns the number of lines appended
 static uint32_t
-bare_ncchannel_get_rgb(
+bare_nclog_append(
   js_env_t *env,
-  uint32_t channel
+  js_arraybuffer_span_of_t<bare_nclog_t, 1> log,
+  js_arraybuffer_t data,
+  uint32_t offset,
+  uint32_t len
 ) {
-  return ncchannel_rgb(channel);
-}
+  const uint8_t *p = utf8_slice(env, data, offset, len);
+  const uint8_t *end = p + len;
 
-static uint32_t
-bare_ncchannel_set_rgb(
-  js_env_t *env,
-  uint32_t channel,
-  uint32_t rgb
-) {
-  ncchannel_set(&channel, rgb);
-  return channel;
-}
+  uint32_t appended = 0;
 
-static uint32_t
-bare_ncchannel_get_alpha(
-  js_env_t *env,
-  uint32_t channel
-) {
-  return ncchannel_alpha(channel);
+  while (p < end) {
+    auto nl = reinterpret_cast<const uint8_t *>(memchr(p, '\n', end - p));
+    const uint8_t *stop = nl ? nl : end;
+
+    uint32_t line_len = static_cast<uint32_t>(stop - p);
+    if (line_len > 0 && p[line_len - 1] == '\r') line_len--;
+
+    log_push(&*log, p, line_len);
+    appended++;
+
+    p = nl ? nl + 1 : end;
+  }
+
+  return appended;
 }
 
-static uint32_t
-bare_ncchannel_set_alpha(
-  js_env_t *env,
-  uint32_t channel,
-  uint32_t alpha
-) {
-  ncchannel_set_alpha(&channel, alpha);
-  return channel;
+static void
+bare_nclog_clear(js_env_t *env, js_arraybuffer_span_of_t<bare_nclog_t, 1> log) {
+  log->first = 0;
+  log->count = 0;
+  log->head = 0;
+  log->scroll = 0;
+  log->dirty = true;
 }
 
 static uint32_t
-bare_ncchannel_get_palindex(
-  js_env_t *env,
-  uint32_t channel
-) {
-  return ncchannel_palindex(channel);
+bare_nclog_length(js_env_t *env, js_arraybuffer_span_of_t<bare_nclog_t, 1> log) {
+  return log->count;
 }
 
+// moves the window delta lines back in history, negative towards the
+// newest line, returns the resulting offset from the bottom
 static uint32_t
-bare_ncchannel_set_palindex(
-  js_env_t *env,
-  uint32_t channel,
-  uint32_t index
-) {
-  ncchannel_set_palindex(&channel, index);
-  return channel;
-}
+bare_nclog_scroll(js_env_t *env, js_arraybuffer_span_of_t<bare_nclog_t, 1> log, int32_t delta) {
+  int64_t scroll = int64_t(log->scroll) + delta;
+  int64_t max = log->count > 0 ? log->count - 1 : 0;
 
-static bool
-bare_ncchannel_is_default(
-  js_env_t *env,
-  uint32_t channel
-) {
-  return ncchannel_default_p(channel);
-}
+  if (scroll < 0) scroll = 0;
+  if (scroll > max) scroll = max;
 
-static bool
-bare_ncchannel_is_rgb(
-  js_env_t *env,
-  uint32_t channel
-) {
-  return ncchannel_rgb_p(channel);
+  if (scroll != log->scroll) {
+    log->scroll = static_cast<uint32_t>(scroll);
+    log->dirty = true;
+  }
+
+  return log->scroll;
 }
 
+// draws the visible window into plane, skipped unless lines, scroll or
+// the plane geometry changed since the last render
 static bool
-bare_ncchannel_is_indexed(
+bare_nclog_render(
   js_env_t *env,
-  uint32_t channel
+  js_arraybuffer_span_of_t<bare_nclog_t, 1> log,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  bool force
 ) {
-  return ncchannel_palindex_p(channel);
+  ncplane *n = plane->handle;
+
+  unsigned rows, cols;
+  ncplane_dim_yx(n, &rows, &cols);
+
+  if (!force && !log->dirty && rows == log->rows && cols == log->cols) return false;
+
+  uint32_t last = log->scroll < log->count ? log->count - log->scroll : 0;
+  uint32_t first = last > rows ? last - rows : 0;
+
+  // overlong lines are clipped at the right edge rather than scrolled
+  bool scrolling = ncplane_set_scrolling(n, false);
+
+  ncplane_erase(n);
+
+  for (uint32_t i = first; i < last; i++) {
+    auto line = log_line(&*log, i);
+
+    ncplane_putnstr_yx(n, i - first, 0, line->len, reinterpret_cast<const char *>(log->arena + line->start % log->arena_len));
+  }
+
+  ncplane_set_scrolling(n, scrolling);
+
+  log->dirty = false;
+  log->rows = rows;
+  log->cols = cols;
+
+  sync_plane_state(&*plane);
+
+  return true;
 }
 
-static js_arraybuffer_t
-bare_ncvisual_create(
+// must match PLOT_* in lib/plot.js
+enum {
+  BARE_NCPLOT_UINT = 0,
+  BARE_NCPLOT_DOUBLE = 1,
+};
+
+typedef struct {
+  int type;
+  ncuplot *uplot;
+  ncdplot *dplot;
+} bare_ncplot_t;
+
+// the plot takes ownership of plane, it is destroyed with the plot
+static std::optional<js_arraybuffer_t>
+bare_ncplot_create(
   js_env_t *env,
-  js_arraybuffer_t data,
-  uint32_t offset,
-  uint32_t len,
-  uint32_t width,
-  uint32_t height,
-  uint32_t bpp // bytes per pixel
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  uint32_t type,
+  double miny,
+  double maxy,
+  uint32_t min_fchannel,
+  uint32_t min_bchannel,
+  uint32_t max_fchannel,
+  uint32_t max_bchannel,
+  uint32_t legend_style,
+  int32_t gridtype,
+  int32_t rangex,
+  std::optional<std::string> title,
+  uint64_t flags
 ) {
   int err;
 
+  assert(legend_style <= 0xFFFF && "uint16_t");
+
   js_arraybuffer_t handle;
-  bare_ncvisual_t *visual;
+  bare_ncplot_t *plot;
 
-  err = js_create_arraybuffer(env, visual, handle);
+  err = js_create_arraybuffer(env, plot, handle);
   assert(err == 0);
 
-  // save ref to redraw on resize
-  err = js_create_reference(env, data, visual->data);
-  assert(err == 0);
+  ncplot_options opts = {
+    .maxchannels = ncchannels_combine(max_fchannel, max_bchannel),
+    .minchannels = ncchannels_combine(min_fchannel, min_bchannel),
+    .legendstyle = static_cast<uint16_t>(legend_style),
+    .gridtype = static_cast<ncblitter_e>(gridtype),
+    .rangex = rangex,
+    .title = title ? title->c_str() : nullptr,
+    .flags = flags,
+  };
 
-  visual->offset = offset;
-  visual->len = len;
-  visual->width = width;
-  visual->height = height;
-  visual->bpp = bpp;
+  plot->type = type;
+  plot->uplot = nullptr;
+  plot->dplot = nullptr;
 
-  std::span<uint8_t> rgba;
-  err = js_get_arraybuffer_info(env, data, rgba);
-  assert(err == 0);
-  assert(rgba.size() <= offset + len && "BUFFER SLICE");
-  assert(height * width * 4 == len && "PIXELS");
+  auto nc = plane_notcurses(plane->handle);
+
+  if (type == BARE_NCPLOT_UINT) {
+    plot->uplot = ncuplot_create(plane->handle, &opts, static_cast<uint64_t>(miny), static_cast<uint64_t>(maxy));
+  } else {
+    plot->dplot = ncdplot_create(plane->handle, &opts, miny, maxy);
+  }
 
-  visual->handle = ncvisual_from_rgba(&rgba[offset], height, width * bpp, width);
+  if (plot->uplot == nullptr && plot->dplot == nullptr) {
+    // notcurses destroys the plane when creation fails
+    plane_unwrap(nc, &*plane);
+
+    return std::nullopt;
+  }
+
+  sync_plane_state(&*plane);
 
   return handle;
 }
 
 static void
-bare_ncvisual_destroy(
+bare_ncplot_destroy(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_ncvisual_t, 1> visual
+  js_arraybuffer_span_of_t<bare_ncplot_t, 1> plot,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane
 ) {
-  visual->data.reset();
-  ncvisual_destroy(visual->handle);
+  auto nc = plane_notcurses(plane->handle);
+
+  assert(!blit_targets(nc, plane->handle, false) && "BLIT IN FLIGHT");
+
+  cache_detach(&nc->bitmap_cache, plane->handle, false);
+
+  if (plot->type == BARE_NCPLOT_UINT) ncuplot_destroy(plot->uplot);
+  else ncdplot_destroy(plot->dplot);
+
+  plot->uplot = nullptr;
+  plot->dplot = nullptr;
+
+  plane_unwrap(nc, &*plane);
 }
 
-static std::optional<js_arraybuffer_t>
-bare_ncvisual_blit(
+// feeds count consecutive samples from BigUint64Array or Float64Array
+// data into slots x, x + 1, ..., replacing instead of adding when set.
+// returns the samples taken, stopping at the first rejected one
+static int32_t
+bare_ncplot_samples(
   js_env_t *env,
-  js_arraybuffer_span_of_t<bare_notcurses_t, 1> nc,
-  js_arraybuffer_span_of_t<bare_ncvisual_t, 1> visual,
-  std::optional<js_arraybuffer_span_of_t<bare_ncplane_t, 1>> dst,
-  int y,
-  int x,
-  int scaling,
-  int blitter,
-  uint64_t flags
+  js_arraybuffer_span_of_t<bare_ncplot_t, 1> plot,
+  js_arraybuffer_span_of_t<bare_ncplane_t, 1> plane,
+  double x,
+  js_arraybuffer_t data,
+  uint32_t offset,
+  uint32_t count,
+  bool set
 ) {
-  ncvisual_options opts = {
-    .y = y,
-    .x = x,
-    .blitter = static_cast<ncblitter_e>(blitter),
-    .flags = flags,
-  };
+  int err;
 
-  //  .scaling = NCSCALE_STRETCH,
-  //  .blitter = NCBLIT_3x2, // Seems default
+  std::span<uint8_t> bytes;
+  err = js_get_arraybuffer_info(env, data, bytes);
+  assert(err == 0);
+  assert(offset + size_t(count) * 8 <= bytes.size() && "SAMPLES SLICE");
 
-  if (dst) {
-    opts.n = (*dst)->handle;
-    opts.scaling = static_cast<ncscale_e>(scaling);
+  uint64_t slot = static_cast<uint64_t>(x);
+  uint32_t i = 0;
 
-    ncplane *cplane = ncvisual_blit(nc->handle, visual->handle, &opts);
-    assert(cplane == (*dst)->handle);
+  if (plot->type == BARE_NCPLOT_UINT) {
+    auto samples = reinterpret_cast<const uint64_t *>(&bytes[offset]);
 
-    return std::nullopt;
+    for (; i < count; i++) {
+      int res = set
+                  ? ncuplot_set_sample(plot->uplot, slot + i, samples[i])
+                  : ncuplot_add_sample(plot->uplot, slot + i, samples[i]);
+      if (res < 0) break;
+    }
   } else {
-    js_arraybuffer_t handle;
-    bare_ncplane_t *plane;
+    auto samples = reinterpret_cast<const double *>(&bytes[offset]);
+
+    for (; i < count; i++) {
+      int res = set
+                  ? ncdplot_set_sample(plot->dplot, slot + i, samples[i])
+                  : ncdplot_add_sample(plot->dplot, slot + i, samples[i]);
+      if (res < 0) break;
+    }
+  }
 
-    int err = js_create_arraybuffer(env, plane, handle);
-    assert(err == 0);
+  sync_plane_state(&*plane);
 
-    plane->handle = ncvisual_blit(nc->handle, visual->handle, &opts);
-    assert(plane->handle != nullptr);
+  return static_cast<int32_t>(i);
+}
 
-    return handle;
+static std::optional<double>
+bare_ncplot_sample(js_env_t *env, js_arraybuffer_span_of_t<bare_ncplot_t, 1> plot, double x) {
+  uint64_t slot = static_cast<uint64_t>(x);
+
+  if (plot->type == BARE_NCPLOT_UINT) {
+    uint64_t y;
+    if (ncuplot_sample(plot->uplot, slot, &y) < 0) return std::nullopt;
+    return static_cast<double>(y);
   }
+
+  double y;
+  if (ncdplot_sample(plot->dplot, slot, &y) < 0) return std::nullopt;
+  return y;
 }
 
 int32_t
 bare_notcurses_ncstrwidth(js_env_t *env, std::string text, bool ignoreInvalid) {
-  int bytes, width;
+  return utf8_width(reinterpret_cast<const uint8_t *>(text.data()), text.size(), ignoreInvalid);
+}
 
-  int res = ncstrwidth(text.c_str(), &bytes, &width);
+int32_t
+bare_notcurses_ncstrwidth_utf8(
+  js_env_t *env,
+  js_arraybuffer_t data,
+  uint32_t offset,
+  uint32_t len,
+  bool ignoreInvalid
+) {
+  return utf8_width(utf8_slice(env, data, offset, len), len, ignoreInvalid);
+}
 
-  if (res < 0 && ignoreInvalid) return width;
-  return res;
+// measures count strings packed into text, string i spans
+// offsets[i] to offsets[i + 1], widths are written as int32
+void
+bare_notcurses_ncstrwidth_batch(
+  js_env_t *env,
+  js_arraybuffer_t text,
+  uint32_t text_offset,
+  uint32_t text_len,
+  js_arraybuffer_t offsets,
+  uint32_t offsets_offset,
+  uint32_t count,
+  js_arraybuffer_t widths,
+  uint32_t widths_offset,
+  bool ignoreInvalid
+) {
+  int err;
+
+  const uint8_t *p = utf8_slice(env, text, text_offset, text_len);
+
+  std::span<uint8_t> offsets_data;
+  err = js_get_arraybuffer_info(env, offsets, offsets_data);
+  assert(err == 0);
+  assert(offsets_offset + (size_t(count) + 1) * sizeof(uint32_t) <= offsets_data.size() && "OFFSETS SLICE");
+
+  std::span<uint8_t> widths_data;
+  err = js_get_arraybuffer_info(env, widths, widths_data);
+  assert(err == 0);
+  assert(widths_offset + size_t(count) * sizeof(int32_t) <= widths_data.size() && "WIDTHS SLICE");
+
+  auto in = reinterpret_cast<const uint32_t *>(&offsets_data[offsets_offset]);
+  auto out = reinterpret_cast<int32_t *>(&widths_data[widths_offset]);
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t start = in[i];
+    uint32_t end = in[i + 1];
+    assert(start <= end && end <= text_len && "OFFSETS");
+
+    out[i] = utf8_width(p + start, end - start, ignoreInvalid);
+  }
 }
 
 js_value_t *
@@ -1007,20 +4642,45 @@ bare_notcurses_exports(js_env_t *env, js_value_t *exports) {
   V("inputStart", bare_notcurses_input_start)
   V("inputStop", bare_notcurses_input_stop)
   V("render", bare_notcurses_render)
+  V("renderAsync", bare_notcurses_render_async)
+  V("pileRenders", bare_notcurses_pile_renders)
+  V("blitsInFlight", bare_notcurses_blits)
+  V("renderSchedule", bare_notcurses_render_schedule)
+  V("requestRender", bare_notcurses_request_render)
+  V("stats", bare_notcurses_stats)
+  V("readSink", bare_notcurses_read_sink)
   V("pixelSupport", bare_notcurses_check_pixel_support)
 
+  // ncpile
+
+  V("pileCreate", bare_ncpile_create)
+  V("pileTop", bare_ncpile_top)
+  V("pileBottom", bare_ncpile_bottom)
+  V("pileRender", bare_ncpile_render)
+  V("pileRasterize", bare_ncpile_rasterize)
+  V("pileRenderAsync", bare_ncpile_render_async)
+  V("pileRendering", bare_ncpile_rendering)
+  V("pileRenderToBuffer", bare_ncpile_render_to_buffer)
+
   // ncplane
 
   V("planeCreate", bare_ncplane_create)
   V("planeDestroy", bare_ncplane_destroy)
+  V("planeRelease", bare_ncplane_release)
+  V("planeBlitTarget", bare_ncplane_blit_target)
+  V("planeAcquire", bare_ncplane_acquire)
   V("planeFamilyDestroy", bare_ncplane_family_destroy)
   V("planePixelGeom", bare_ncplane_pixel_geom)
   V("planeMoveYX", bare_ncplane_move_yx)
   V("planeResizeSimple", bare_ncplane_resize_simple)
   V("planeErase", bare_ncplane_erase)
   V("planeSetBase", bare_ncplane_set_base)
+  V("planeSetBaseUtf8", bare_ncplane_set_base_utf8)
   V("planePutstrYX", bare_ncplane_putstr_yx)
+  V("planePutnstrYX", bare_ncplane_putnstr_yx)
+  V("planePutText", bare_ncplane_puttext)
   V("planeVLine", bare_ncplane_vline)
+  V("planeVLineUtf8", bare_ncplane_vline_utf8)
   V("planeMergedown", bare_ncplane_mergedown_simple)
   V("planePerimeter", bare_ncplane_perimeter_simple)
   // V("planeHLine", bare_ncplane_hline)
@@ -1033,33 +4693,18 @@ bare_notcurses_exports(js_env_t *env, js_value_t *exports) {
   V("planeMoveTop", bare_ncplane_move_top)
   V("planeReparentFamily", bare_ncplane_reparent_family)
   V("planeContents", bare_ncplane_contents)
+  V("planeSnapshot", bare_ncplane_snapshot)
+  V("planeExec", bare_ncplane_exec)
+  V("planePutCells", bare_ncplane_put_cells)
   // ncplane_box()
 
-  V("getPlaneY", bare_ncplane_get_y)
-  V("getPlaneX", bare_ncplane_get_x)
-  V("getPlaneDimY", bare_ncplane_get_dim_y)
-  V("getPlaneDimX", bare_ncplane_get_dim_x)
   V("getPlaneName", bare_ncplane_get_name)
   V("setPlaneName", bare_ncplane_set_name)
-  V("getPlaneCursorY", bare_ncplane_get_cursor_y)
-  V("getPlaneCursorX", bare_ncplane_get_cursor_x)
-  V("getPlaneStyles", bare_ncplane_get_styles)
   V("setPlaneStyles", bare_ncplane_set_styles)
-  V("getPlaneChannels", bare_ncplane_get_channels)
+  V("getPlaneFchannel", bare_ncplane_get_fchannel)
+  V("getPlaneBchannel", bare_ncplane_get_bchannel)
   V("setPlaneChannels", bare_ncplane_set_channels)
-
-  // ncinput
-
-  V("getEventId", bare_ncinput_get_id)
-  V("getEventType", bare_ncinput_get_type)
-  V("getEventY", bare_ncinput_get_y)
-  V("getEventX", bare_ncinput_get_x)
-  V("getEventYpx", bare_ncinput_get_ypx)
-  V("getEventXpx", bare_ncinput_get_xpx)
-  V("getEventUtf8", bare_ncinput_get_utf8)
-  V("getEventModifiers", bare_ncinput_get_modifiers)
-  V("getEventEffText", bare_ncinput_get_eff_text)
-  V("getEventMouse", bare_ncpinput_get_mouse)
+  V("planeSyncState", bare_ncplane_sync_state)
 
   // ncchannels u64-ops
   V("getChannelFg", bare_ncchannels_get_fchannel)
@@ -1078,15 +4723,46 @@ bare_notcurses_exports(js_env_t *env, js_value_t *exports) {
   V("isChannelRGB", bare_ncchannel_is_rgb)
   V("isChannelIndexed", bare_ncchannel_is_indexed)
 
+  // bulk ops over Uint32Array pairs
+  V("channelsTransform", bare_ncchannels_transform)
+
   // ncvisual
 
   V("visualCreate", bare_ncvisual_create);
+  V("visualCreateScaled", bare_ncvisual_create_scaled);
+  V("visualMediaDefblitter", bare_ncvisual_media_defblitter);
+  V("visualUpdate", bare_ncvisual_update);
+  V("visualBlitCached", bare_ncvisual_blit_cached);
+  V("visualDecodePNG", bare_ncvisual_decode_png);
+  V("visualCacheBudget", bare_ncvisual_cache_budget);
+  V("visualCacheClear", bare_ncvisual_cache_clear);
+  V("visualCacheStats", bare_ncvisual_cache_stats);
   V("visualDestroy", bare_ncvisual_destroy);
   V("visualBlit", bare_ncvisual_blit);
+  V("visualBlitAsync", bare_ncvisual_blit_async);
+
+  // log view
+
+  V("logCreate", bare_nclog_create);
+  V("logDestroy", bare_nclog_destroy);
+  V("logAppend", bare_nclog_append);
+  V("logClear", bare_nclog_clear);
+  V("logLength", bare_nclog_length);
+  V("logScroll", bare_nclog_scroll);
+  V("logRender", bare_nclog_render);
+
+  // plot
+
+  V("plotCreate", bare_ncplot_create);
+  V("plotDestroy", bare_ncplot_destroy);
+  V("plotSamples", bare_ncplot_samples);
+  V("plotSample", bare_ncplot_sample);
 
   // util
 
   V("ncstrwidth", bare_notcurses_ncstrwidth);
+  V("ncstrwidthUtf8", bare_notcurses_ncstrwidth_utf8);
+  V("ncstrwidthBatch", bare_notcurses_ncstrwidth_batch);
 #undef V
 
   // constants
@@ -1121,6 +4797,16 @@ bare_notcurses_exports(js_env_t *env, js_value_t *exports) {
   V(NCSTYLE_STRUCK)
   V(NCSTYLE_NONE)
 
+  V(NCALPHA_HIGHCONTRAST)
+  V(NCALPHA_TRANSPARENT)
+  V(NCALPHA_BLEND)
+  V(NCALPHA_OPAQUE)
+
+  V(NC_BGDEFAULT_MASK)
+  V(NC_BG_RGB_MASK)
+  V(NC_BG_PALETTE)
+  V(NC_BG_ALPHA_MASK)
+
   V(NCTYPE_UNKNOWN)
   V(NCTYPE_PRESS)
   V(NCTYPE_REPEAT)
@@ -1157,6 +4843,18 @@ bare_notcurses_exports(js_env_t *env, js_value_t *exports) {
   V(NCSCALE_NONE_HIRES)
   V(NCSCALE_SCALE_HIRES)
 
+  V(NCALIGN_UNALIGNED)
+  V(NCALIGN_LEFT)
+  V(NCALIGN_CENTER)
+  V(NCALIGN_RIGHT)
+
+  V(NCPLOT_OPTION_LABELTICKSD)
+  V(NCPLOT_OPTION_EXPONENTIALD)
+  V(NCPLOT_OPTION_VERTICALI)
+  V(NCPLOT_OPTION_NODEGRADE)
+  V(NCPLOT_OPTION_DETECTMAXONLY)
+  V(NCPLOT_OPTION_PRINTSAMPLE)
+
   V(NCVISUAL_OPTION_NODEGRADE)
   V(NCVISUAL_OPTION_BLEND)
   V(NCVISUAL_OPTION_HORALIGNED)
@@ -1341,6 +5039,32 @@ bare_notcurses_exports(js_env_t *env, js_value_t *exports) {
   V("NOTCURSES_ACCOUNTNAME", tmp)
   free(tmp);
 
+#undef V
+
+  // ncinput record layout, used to read events without crossing the binding
+
+#define V(name, value) \
+  err = js_set_property(env, exports, name, static_cast<uint32_t>(value)); \
+  assert(err == 0);
+
+  // bare_ncplane_t holds C++ members, offsetof is not portable on it
+  bare_ncplane_t probe;
+  V("NCPLANE_STATE_OFFSET", reinterpret_cast<uint8_t *>(&probe.state) - reinterpret_cast<uint8_t *>(&probe))
+  V("NCPLANE_STATE_SIZE", sizeof(bare_ncplane_state_t))
+
+  V("NCINPUT_SIZE", sizeof(ncinput))
+  V("NCINPUT_OFFSET_ID", offsetof(ncinput, id))
+  V("NCINPUT_OFFSET_Y", offsetof(ncinput, y))
+  V("NCINPUT_OFFSET_X", offsetof(ncinput, x))
+  V("NCINPUT_OFFSET_UTF8", offsetof(ncinput, utf8))
+  V("NCINPUT_OFFSET_EVTYPE", offsetof(ncinput, evtype))
+  V("NCINPUT_OFFSET_MODIFIERS", offsetof(ncinput, modifiers))
+  V("NCINPUT_OFFSET_YPX", offsetof(ncinput, ypx))
+  V("NCINPUT_OFFSET_XPX", offsetof(ncinput, xpx))
+  V("NCINPUT_OFFSET_EFF_TEXT", offsetof(ncinput, eff_text))
+  V("NCINPUT_MAX_EFF_TEXT_CODEPOINTS", NCINPUT_MAX_EFF_TEXT_CODEPOINTS)
+  V("NCINPUT_RING_HEADER_SIZE", sizeof(bare_notcurses_input_ring_t))
+
 #undef V
   return exports;
 }
@@ -3,19 +3,82 @@ const Plane = require('./lib/plane')
 const InputEvent = require('./lib/input-event')
 const Channels = require('./lib/channels')
 const Visual = require('./lib/visual')
+const CommandBuffer = require('./lib/command-buffer')
+const LogView = require('./lib/log-view')
+const Plot = require('./lib/plot')
+const PlanePool = require('./lib/plane-pool')
 const constants = require('./lib/constants')
 const binding = require('./binding')
 
 function ncstrwidth (str, ignoreInvalidUnicode = false) {
+  if (ArrayBuffer.isView(str)) {
+    return binding.ncstrwidthUtf8(str.buffer, str.byteOffset, str.byteLength, ignoreInvalidUnicode)
+  }
+
   return binding.ncstrwidth(str, ignoreInvalidUnicode)
 }
 
+let packed = Buffer.alloc(4096)
+let packedOffsets = new Uint32Array(256)
+
+/**
+ * Measures many strings in one call
+ * @param {string[]|Uint8Array} input strings or packed UTF-8 text
+ * @param {Uint32Array} [offsets] with packed text, count + 1 byte offsets
+ * @param {Uint32Array} [target] reusable output, one width per string
+ * @returns {Uint32Array} widths, 0xffffffff marks invalid unicode
+ */
+function ncstrwidths (input, offsets, target = null, ignoreInvalidUnicode = false) {
+  if (!ArrayBuffer.isView(input)) {
+    ignoreInvalidUnicode = target ?? false
+    target = offsets ?? null
+
+    const count = input.length
+    if (packedOffsets.length < count + 1) packedOffsets = new Uint32Array(count + 1)
+
+    let len = 0
+    for (let i = 0; i < count; i++) {
+      const str = input[i]
+      packedOffsets[i] = len
+
+      if (packed.byteLength < len + str.length * 3) {
+        const next = Buffer.alloc(Math.max(packed.byteLength * 2, len + str.length * 3))
+        next.set(packed.subarray(0, len))
+        packed = next
+      }
+
+      len += packed.write(str, len)
+    }
+    packedOffsets[count] = len
+
+    input = packed.subarray(0, len)
+    offsets = packedOffsets.subarray(0, count + 1)
+  }
+
+  const count = offsets.length - 1
+  if (target === null || target.length < count) target = new Uint32Array(count)
+
+  binding.ncstrwidthBatch(
+    input.buffer, input.byteOffset, input.byteLength,
+    offsets.buffer, offsets.byteOffset, count,
+    target.buffer, target.byteOffset,
+    ignoreInvalidUnicode
+  )
+
+  return target
+}
+
 module.exports = {
   Notcurses,
   Plane,
   InputEvent,
   Channels,
   Visual,
+  CommandBuffer,
+  LogView,
+  Plot,
+  PlanePool,
   ncstrwidth,
+  ncstrwidths,
   ...constants
 }
@@ -1,48 +1,82 @@
 const binding = require('../binding')
 
+const DEFAULT_MASK = binding.NC_BGDEFAULT_MASK
+const PALETTE = binding.NC_BG_PALETTE
+const RGB_MASK = binding.NC_BG_RGB_MASK
+const ALPHA_MASK = binding.NC_BG_ALPHA_MASK
+
+// must match BARE_NCCHANNELS_* in binding.cc
+const OPS = {
+  rgb: 0,
+  alpha: 1,
+  palindex: 2,
+  default: 3,
+  reverse: 4
+}
+
+const WHICH = {
+  fg: 1,
+  bg: 2,
+  both: 3
+}
+
+// [bg, fg] pair for single reversals
+const scratch = new Uint32Array(2)
+
 class Channels {
   #stack = []
   #proxy = null
-  #value = 0n
-  constructor (channels = 0n) {
+  #fg = 0
+  #bg = 0
+
+  constructor (channels = 0) {
     if (
       typeof channels === 'object' &&
-      typeof channels.get === 'function' &&
+      typeof channels?.getFg === 'function' &&
+      typeof channels.getBg === 'function' &&
       typeof channels.set === 'function'
     ) {
       // proxy all reads/writes directly to plane
       this.#proxy = channels
-    } else if (typeof channels === 'bigint') {
-      this.#value = channels // default
     } else {
-      throw new Error('unsupported value' + channels)
+      this.set(Channels.fgOf(channels), Channels.bgOf(channels))
     }
   }
 
+  /** 64bit value, prefer `fg`, `bg` and `set()` which do not allocate */
   get value () {
-    return this.#proxy ? this.#proxy.get() : this.#value
+    return BigInt(this.fg) << 32n | BigInt(this.bg)
   }
 
   set value (v) {
+    this.set(Channels.fgOf(v), Channels.bgOf(v))
+  }
+
+  /** Set both 32bit channels at once */
+  set (fg, bg) {
+    fg >>>= 0
+    bg >>>= 0
+
     if (this.#proxy) {
-      this.#proxy.set(v)
+      this.#proxy.set(fg, bg)
     } else {
-      this.#value = v
+      this.#fg = fg
+      this.#bg = bg
     }
   }
 
   // foreground
 
   get fg () {
-    return binding.getChannelFg(this.value)
+    return this.#proxy ? this.#proxy.getFg() : this.#fg
   }
 
   set fg (value) {
-    this.value = binding.combineChannels(value, this.bg)
+    this.set(value, this.bg)
   }
 
   get fgRgb () {
-    return binding.getChannelRGB(this.fg)
+    return this.fg & RGB_MASK
   }
 
   set fgRgb (rgb) {
@@ -50,37 +84,45 @@ class Channels {
   }
 
   get fgIdx () {
-    return binding.getChannelPalindex(this.fg)
+    return this.fg & 0xff
   }
 
   set fgIdx (idx) {
     this.fg = binding.setChannelPalindex(this.fg, idx)
   }
 
+  get fgAlpha () {
+    return this.fg & ALPHA_MASK
+  }
+
+  set fgAlpha (alpha) {
+    this.fg = binding.setChannelAlpha(this.fg, alpha)
+  }
+
   get isFgRgb () {
-    return binding.isChannelRGB(this.fg)
+    return isRgb(this.fg)
   }
 
   get isFgIndexed () {
-    return binding.isChannelIndexed(this.fg)
+    return isIndexed(this.fg)
   }
 
   get isFgDefault () {
-    return binding.isChannelDefault(this.fg)
+    return isDefault(this.fg)
   }
 
   // background
 
   get bg () {
-    return binding.getChannelBg(this.value)
+    return this.#proxy ? this.#proxy.getBg() : this.#bg
   }
 
   set bg (value) {
-    this.value = binding.combineChannels(this.fg, value)
+    this.set(this.fg, value)
   }
 
   get bgRgb () {
-    return binding.getChannelRGB(this.bg)
+    return this.bg & RGB_MASK
   }
 
   set bgRgb (rgb) {
@@ -88,57 +130,132 @@ class Channels {
   }
 
   get bgIdx () {
-    return binding.getChannelPalindex(this.bg)
+    return this.bg & 0xff
   }
 
   set bgIdx (idx) {
     this.bg = binding.setChannelPalindex(this.bg, idx)
   }
 
+  get bgAlpha () {
+    return this.bg & ALPHA_MASK
+  }
+
+  set bgAlpha (alpha) {
+    this.bg = binding.setChannelAlpha(this.bg, alpha)
+  }
+
   get isBgRgb () {
-    return binding.isChannelRGB(this.bg)
+    return isRgb(this.bg)
   }
 
   get isBgIndexed () {
-    return binding.isChannelIndexed(this.bg)
+    return isIndexed(this.bg)
   }
 
   get isBgDefault () {
-    return binding.isChannelDefault(this.bg)
+    return isDefault(this.bg)
   }
 
   get reverse () {
-    return new Channels(binding.reverseChannels(this.value))
+    scratch[0] = this.bg
+    scratch[1] = this.fg
+    binding.channelsTransform(scratch.buffer, scratch.byteOffset, 1, OPS.reverse, 0, 0)
+
+    return Channels.from(scratch[1], scratch[0])
   }
 
   push () {
-    this.#stack.push(this.value)
+    this.#stack.push(this.fg, this.bg)
   }
 
   pop () {
     if (!this.#stack.length) throw new Error('stack is empty')
-    this.value = this.#stack.pop()
+
+    const bg = this.#stack.pop()
+    const fg = this.#stack.pop()
+    this.set(fg, bg)
   }
 
   static from (fgChannel, bgChannel) {
     // combine channels
     if (typeof bgChannel === 'number' && typeof fgChannel === 'number') {
-      return new Channels(binding.combineChannels(fgChannel, bgChannel))
+      const channels = new Channels()
+      channels.set(fgChannel, bgChannel)
+      return channels
     }
 
-    if (typeof fgChannel === 'bigint') return new Channels(fgChannel)
+    return new Channels(fgChannel ?? 0)
+  }
 
-    // lossy bigint
-    if (typeof fgChannel === 'number') return new Channels(BigInt(fgChannel))
+  /**
+   * Foreground of any value accepted as channels
+   * @param {Channels|bigint|number|Uint32Array} channels
+   */
+  static fgOf (channels) {
+    if (channels instanceof Channels) return channels.fg
+    if (typeof channels === 'number') return Math.floor(channels / 0x100000000) >>> 0
+    if (typeof channels === 'bigint') return Number((channels >> 32n) & 0xffffffffn)
+    if (channels instanceof Uint32Array) return channels[1]
+    if (channels == null) return 0
+
+    throw new Error('unsupported value ' + channels)
+  }
+
+  /**
+   * Background of any value accepted as channels
+   * @param {Channels|bigint|number|Uint32Array} channels
+   */
+  static bgOf (channels) {
+    if (channels instanceof Channels) return channels.bg
+    if (typeof channels === 'number') return channels >>> 0
+    if (typeof channels === 'bigint') return Number(channels & 0xffffffffn)
+    if (channels instanceof Uint32Array) return channels[0]
+    if (channels == null) return 0
+
+    throw new Error('unsupported value ' + channels)
+  }
+
+  // bulk ops over Uint32Arrays of [bg, fg] pairs, the layout of 64bit channels
+
+  static setRgb (pairs, rgb, which = 'both') {
+    transform(pairs, OPS.rgb, which, rgb)
+  }
 
-    // dupe
-    if (fgChannel instanceof Channels) return new Channels(fgChannel.value)
+  static setAlpha (pairs, alpha, which = 'both') {
+    transform(pairs, OPS.alpha, which, alpha)
+  }
 
-    // null-channel
-    if (!fgChannel) return new Channels(0n)
+  static setPalindex (pairs, idx, which = 'both') {
+    transform(pairs, OPS.palindex, which, idx)
+  }
+
+  static setDefault (pairs, which = 'both') {
+    transform(pairs, OPS.default, which, 0)
+  }
 
-    throw new Error('failed to deduce channels')
+  static reverse (pairs) {
+    transform(pairs, OPS.reverse, 'both', 0)
   }
 }
 
+function transform (pairs, op, which, value) {
+  if (!(pairs instanceof Uint32Array) || pairs.length % 2 !== 0) throw new Error('expected Uint32Array of [bg, fg] pairs')
+  if (!WHICH[which]) throw new Error('expected fg, bg or both')
+
+  binding.channelsTransform(pairs.buffer, pairs.byteOffset, pairs.length / 2, op, WHICH[which], value)
+}
+
+function isDefault (channel) {
+  return (channel & DEFAULT_MASK) === 0
+}
+
+function isIndexed (channel) {
+  return !isDefault(channel) && (channel & PALETTE) !== 0
+}
+
+function isRgb (channel) {
+  return !isDefault(channel) && (channel & PALETTE) === 0
+}
+
 module.exports = Channels
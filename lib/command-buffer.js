@@ -0,0 +1,145 @@
+const binding = require('../binding')
+const { NCSTYLE_NONE } = require('./constants')
+const Channels = require('./channels')
+
+// opcodes, must match the BARE_NCPLANE_OP_* enum in binding.cc
+const OP_CURSOR_MOVE = 1
+const OP_SET_STYLES = 2
+const OP_SET_CHANNELS = 3
+const OP_PUTSTR = 4
+const OP_ERASE = 5
+const OP_PERIMETER = 6
+
+/**
+ * Reusable buffer of packed draw operations,
+ * replayed against a plane in a single native call
+ * using `plane.exec(commands)`
+ */
+class CommandBuffer {
+  #buffer
+  #view
+  #length = 0
+  #count = 0
+
+  constructor (size = 4096) {
+    this.#buffer = Buffer.alloc(size)
+    this.#view = new DataView(this.#buffer.buffer, this.#buffer.byteOffset, this.#buffer.byteLength)
+  }
+
+  /** amount of bytes encoded */
+  get byteLength () {
+    return this.#length
+  }
+
+  /** amount of ops encoded */
+  get length () {
+    return this.#count
+  }
+
+  get _buffer () {
+    return this.#buffer
+  }
+
+  // replays the ops against a plane handle, see `plane.exec()`
+  _exec (plane) {
+    const count = binding.planeExec(plane, this.#buffer.buffer, this.#buffer.byteOffset, this.#length)
+    if (count < 0) throw new Error('malformed op at index ' + (-1 - count))
+
+    return count
+  }
+
+  cursorMove (y = -1, x = -1) {
+    this.#op(OP_CURSOR_MOVE, 8)
+    this.#i32(y)
+    this.#i32(x)
+  }
+
+  home () {
+    this.cursorMove(0, 0)
+  }
+
+  setStyles (ncstyle) {
+    this.#op(OP_SET_STYLES, 4)
+    this.#u32(ncstyle)
+  }
+
+  setChannels (value) {
+    this.#op(OP_SET_CHANNELS, 8)
+    this.#channels(value)
+  }
+
+  putstr (str, y = -1, x = -1) {
+    // worst case utf8 expansion, shrunk after write
+    this.#op(OP_PUTSTR, 12 + str.length * 3 + 3)
+    this.#i32(y)
+    this.#i32(x)
+
+    const bytes = this.#buffer.write(str, this.#length + 4, 'utf8')
+    this.#u32(bytes)
+    this.#length += (bytes + 3) & ~3
+  }
+
+  erase () {
+    this.#op(OP_ERASE, 0)
+  }
+
+  perimeterRounded (styleMask = NCSTYLE_NONE, channels = 0, ctlword = 0) {
+    this.#perimeter(0, styleMask, channels, ctlword)
+  }
+
+  perimeterDouble (styleMask = NCSTYLE_NONE, channels = 0, ctlword = 0) {
+    this.#perimeter(1, styleMask, channels, ctlword)
+  }
+
+  /** Discard all ops, retaining the allocated memory */
+  reset () {
+    this.#length = 0
+    this.#count = 0
+  }
+
+  #perimeter (type, styleMask, channels, ctlword) {
+    this.#op(OP_PERIMETER, 20)
+    this.#u32(type)
+    this.#u32(styleMask)
+    this.#channels(channels)
+    this.#u32(ctlword)
+  }
+
+  #op (code, argsLength) {
+    this.#reserve(4 + argsLength)
+    this.#u32(code)
+    this.#count++
+  }
+
+  #reserve (bytes) {
+    const required = this.#length + bytes
+    if (required <= this.#buffer.byteLength) return
+
+    let size = this.#buffer.byteLength * 2
+    while (size < required) size *= 2
+
+    const buffer = Buffer.alloc(size)
+    this.#buffer.copy(buffer, 0, 0, this.#length)
+
+    this.#buffer = buffer
+    this.#view = new DataView(buffer.buffer, buffer.byteOffset, buffer.byteLength)
+  }
+
+  #i32 (value) {
+    this.#view.setInt32(this.#length, value, true)
+    this.#length += 4
+  }
+
+  #u32 (value) {
+    this.#view.setUint32(this.#length, value, true)
+    this.#length += 4
+  }
+
+  // little endian u64, bg in the low word
+  #channels (value) {
+    this.#u32(Channels.bgOf(value))
+    this.#u32(Channels.fgOf(value))
+  }
+}
+
+module.exports = CommandBuffer
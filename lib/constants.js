@@ -28,6 +28,11 @@ module.exports = {
   NCSTYLE_STRUCK: binding.NCSTYLE_STRUCK,
   NCSTYLE_NONE: binding.NCSTYLE_NONE,
 
+  NCALPHA_HIGHCONTRAST: binding.NCALPHA_HIGHCONTRAST,
+  NCALPHA_TRANSPARENT: binding.NCALPHA_TRANSPARENT,
+  NCALPHA_BLEND: binding.NCALPHA_BLEND,
+  NCALPHA_OPAQUE: binding.NCALPHA_OPAQUE,
+
   NCTYPE_UNKNOWN: binding.NCTYPE_UNKNOWN,
   NCTYPE_PRESS: binding.NCTYPE_PRESS,
   NCTYPE_REPEAT: binding.NCTYPE_REPEAT,
@@ -56,6 +61,18 @@ module.exports = {
   NCSCALE_NONE_HIRES: binding.NCSCALE_NONE_HIRES,
   NCSCALE_SCALE_HIRES: binding.NCSCALE_SCALE_HIRES,
 
+  NCALIGN_UNALIGNED: binding.NCALIGN_UNALIGNED,
+  NCALIGN_LEFT: binding.NCALIGN_LEFT,
+  NCALIGN_CENTER: binding.NCALIGN_CENTER,
+  NCALIGN_RIGHT: binding.NCALIGN_RIGHT,
+
+  NCPLOT_OPTION_LABELTICKSD: binding.NCPLOT_OPTION_LABELTICKSD,
+  NCPLOT_OPTION_EXPONENTIALD: binding.NCPLOT_OPTION_EXPONENTIALD,
+  NCPLOT_OPTION_VERTICALI: binding.NCPLOT_OPTION_VERTICALI,
+  NCPLOT_OPTION_NODEGRADE: binding.NCPLOT_OPTION_NODEGRADE,
+  NCPLOT_OPTION_DETECTMAXONLY: binding.NCPLOT_OPTION_DETECTMAXONLY,
+  NCPLOT_OPTION_PRINTSAMPLE: binding.NCPLOT_OPTION_PRINTSAMPLE,
+
   NCVISUAL_OPTION_NODEGRADE: binding.NCVISUAL_OPTION_NODEGRADE,
   NCVISUAL_OPTION_BLEND: binding.NCVISUAL_OPTION_BLEND,
   NCVISUAL_OPTION_HORALIGNED: binding.NCVISUAL_OPTION_HORALIGNED,
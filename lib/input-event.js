@@ -1,19 +1,43 @@
 const binding = require('../binding')
 const { inspect } = require('./util')
+
+const {
+  NCINPUT_SIZE,
+  NCINPUT_OFFSET_ID,
+  NCINPUT_OFFSET_Y,
+  NCINPUT_OFFSET_X,
+  NCINPUT_OFFSET_UTF8,
+  NCINPUT_OFFSET_EVTYPE,
+  NCINPUT_OFFSET_MODIFIERS,
+  NCINPUT_OFFSET_YPX,
+  NCINPUT_OFFSET_XPX,
+  NCINPUT_OFFSET_EFF_TEXT,
+  NCINPUT_MAX_EFF_TEXT_CODEPOINTS
+} = binding
+
+// ncinput records are read directly from memory in host byte order
+const LE = new Uint8Array(new Uint16Array([1]).buffer)[0] === 1
+
 class InputEvent {
   #handle
+  #view
 
-  constructor (handle) {
+  /**
+   * @param {ArrayBuffer} handle buffer holding ncinput records
+   * @param {number} offset byte offset of the record
+   */
+  constructor (handle, offset = 0) {
     this.#handle = handle
+    this.#view = new DataView(handle, offset, NCINPUT_SIZE)
   }
 
   get id () {
-    return binding.getEventId(this.#handle)
+    return this.#view.getUint32(NCINPUT_OFFSET_ID, LE)
   }
 
   get type () {
     // NOTE: "gnome-terminal" always reports NCTYPE_UNKNOWN=0
-    const t = binding.getEventType(this.#handle)
+    const t = this.#view.getInt32(NCINPUT_OFFSET_EVTYPE, LE)
 
     switch (t) {
       case binding.NCTYPE_UNKNOWN:
@@ -30,31 +54,38 @@ class InputEvent {
   }
 
   get y () {
-    return binding.getEventY(this.#handle)
+    return this.#view.getInt32(NCINPUT_OFFSET_Y, LE)
   }
 
   get x () {
-    return binding.getEventX(this.#handle)
+    return this.#view.getInt32(NCINPUT_OFFSET_X, LE)
   }
 
   get ypx () {
-    return binding.getEventYpx(this.#handle)
+    return this.#view.getInt32(NCINPUT_OFFSET_YPX, LE)
   }
 
   get xpx () {
-    return binding.getEventXpx(this.#handle)
+    return this.#view.getInt32(NCINPUT_OFFSET_XPX, LE)
   }
 
   get utf8 () {
-    return binding.getEventUtf8(this.#handle)
+    const { buffer, byteOffset } = this.#view
+    const bytes = new Uint8Array(buffer, byteOffset + NCINPUT_OFFSET_UTF8, 5)
+
+    let end = bytes.indexOf(0)
+    if (end === -1) end = bytes.length
+
+    return Buffer.from(buffer, bytes.byteOffset, end).toString('utf8')
   }
 
   get modifiers () {
-    return binding.getEventModifiers(this.#handle)
+    return this.#view.getUint32(NCINPUT_OFFSET_MODIFIERS, LE)
   }
 
   get mouse () {
-    return binding.getEventMouse(this.#handle)
+    const id = this.id
+    return id >= binding.NCKEY_MOTION && id <= binding.NCKEY_BUTTON11
   }
 
   get alt () {
@@ -90,16 +121,32 @@ class InputEvent {
   }
 
   get text () {
-    const arraybuffer = binding.getEventEffText(this.#handle)
-    const view = new Uint32Array(arraybuffer)
+    let text = ''
 
-    const end = view.findIndex(i => i === 0)
+    for (let i = 0; i < NCINPUT_MAX_EFF_TEXT_CODEPOINTS; i++) {
+      const cp = this.#view.getUint32(NCINPUT_OFFSET_EFF_TEXT + i * 4, LE)
+      if (cp === 0) break
+      text += String.fromCodePoint(cp)
+    }
 
-    const buf = Buffer.from(arraybuffer)
-    const text = buf.subarray(0, end).toString('utf8')
     return text
   }
 
+  /**
+   * Wraps each record of a buffer holding consecutive ncinput records
+   * @param {ArrayBuffer} handle
+   * @returns {InputEvent[]}
+   */
+  static batch (handle) {
+    const events = new Array(handle.byteLength / NCINPUT_SIZE)
+
+    for (let i = 0; i < events.length; i++) {
+      events[i] = new InputEvent(handle, i * NCINPUT_SIZE)
+    }
+
+    return events
+  }
+
   [inspect] () {
     return {
       __proto__: { constructor: InputEvent },
@@ -0,0 +1,77 @@
+const binding = require('../binding')
+
+/** @typedef {import('./plane')} Plane */
+
+class LogView {
+  #plane
+  #handle
+
+  /**
+   * @param {Plane} plane drawn into on render
+   * @param {object} opts `{ lines, bytes }` scrollback limits
+   */
+  constructor (plane, opts = {}) {
+    const {
+      lines = 10000,
+      bytes = 4 * 1024 * 1024
+    } = opts
+
+    this.#plane = plane
+    this.#handle = binding.logCreate(lines, bytes)
+  }
+
+  get plane () {
+    return this.#plane
+  }
+
+  /** number of lines held in scrollback */
+  get length () {
+    return binding.logLength(this.#handle)
+  }
+
+  /** lines between the bottom of the window and the newest line */
+  get scroll () {
+    return binding.logScroll(this.#handle, 0)
+  }
+
+  set scroll (lines) {
+    this.scrollBy(lines - this.scroll)
+  }
+
+  /**
+   * @param {number} delta positive moves back in history
+   * @returns {number} resulting scroll
+   */
+  scrollBy (delta) {
+    return binding.logScroll(this.#handle, delta)
+  }
+
+  /**
+   * @param {string|Uint8Array} text one or more newline separated lines
+   * @returns {number} lines appended
+   */
+  append (text) {
+    if (!ArrayBuffer.isView(text)) text = Buffer.from(text)
+
+    return binding.logAppend(this.#handle, text.buffer, text.byteOffset, text.byteLength)
+  }
+
+  clear () {
+    binding.logClear(this.#handle)
+  }
+
+  /**
+   * Draws the visible window into the plane
+   * @returns {boolean} false when nothing changed since the last render
+   */
+  render (force = false) {
+    return binding.logRender(this.#handle, this.#plane._handle, force)
+  }
+
+  destroy () {
+    binding.logDestroy(this.#handle)
+    this.#handle = null
+  }
+}
+
+module.exports = LogView
@@ -4,12 +4,78 @@ const Plane = require('./plane')
 const { uncaught } = require('./util')
 const { NCMICE_NO_EVENTS } = require('./constants')
 
+// must match BARE_NOTCURSES_INPUT_* in binding.cc
+const INPUT_MODE_EVENT = 0
+const INPUT_MODE_BATCH = 1
+const INPUT_MODE_RING = 2
+
+// input ring header fields
+const RING_HEAD = 0
+const RING_TAIL = 1
+const RING_CAPACITY = 2
+const RING_DROPPED = 3
+
+// must match BARE_NCSTATS_FIELDS in binding.cc
+const STATS_FIELDS = [
+  'renders',
+  'writeouts',
+  'failedRenders',
+  'failedWriteouts',
+  'rasterBytes',
+  'rasterMaxBytes',
+  'rasterMinBytes',
+  'renderNs',
+  'renderMaxNs',
+  'renderMinNs',
+  'rasterNs',
+  'rasterMaxNs',
+  'rasterMinNs',
+  'writeoutNs',
+  'writeoutMaxNs',
+  'writeoutMinNs',
+  'cellElisions',
+  'cellEmissions',
+  'fgElisions',
+  'fgEmissions',
+  'bgElisions',
+  'bgEmissions',
+  'defaultElisions',
+  'defaultEmissions',
+  'refreshes',
+  'sprixelEmissions',
+  'sprixelElisions',
+  'sprixelBytes',
+  'appsyncUpdates',
+  'inputErrors',
+  'inputEvents',
+  'hpaGratuitous',
+  'cellGeoChanges',
+  'pixelGeoChanges',
+  'fbBytes',
+  'planes'
+]
+
 class Notcurses {
   #handle
   #stdplane
+  #inputRing = null
+  #rendering = null
+  #onframe = null
+  #maxFps
+  #scheduled = false
 
   constructor (opts = {}) {
-    this.#handle = binding.init(opts.flags || 0)
+    this.#handle = binding.init(
+      opts.flags || 0,
+      typeof opts.fd === 'number' ? opts.fd : -1,
+      opts.rows || 0,
+      opts.cols || 0,
+      opts.sink === 'memory'
+    )
+
+    this.#onframe = opts.onframe || null
+    this.#maxFps = opts.maxFps || 60
+    if (!(this.#maxFps > 0)) throw new Error('expected positive fps')
 
     if (opts.oninput) {
       this.inputStart(opts.oninput)
@@ -30,7 +96,7 @@ class Notcurses {
   /** @type {Plane} */
   get stdplane () {
     if (!this.#stdplane) {
-      this.#stdplane = new Plane(this, binding.stdplane(this.#handle))
+      this.#stdplane = Plane.from(binding.stdplane(this.#handle))
     }
 
     return this.#stdplane
@@ -40,26 +106,208 @@ class Notcurses {
     return binding.pixelSupport(this.#handle) !== binding.NCPIXEL_NONE
   }
 
-  inputStart (handler, miceEvents = NCMICE_NO_EVENTS) {
+  inputStart (handler, miceEvents = NCMICE_NO_EVENTS, opts = {}) {
     if (typeof handler !== 'function') throw new Error('Callback expected')
 
+    if (opts.ring) {
+      // power of two, slots are masked out of free running counters
+      const capacity = 2 ** Math.ceil(Math.log2(opts.ring === true ? 256 : opts.ring))
+      const mask = capacity - 1
+      const ring = new ArrayBuffer(binding.NCINPUT_RING_HEADER_SIZE + capacity * binding.NCINPUT_SIZE)
+      const header = new Uint32Array(ring, 0, 4)
+      header[RING_CAPACITY] = capacity
+
+      // one reusable event per slot, valid only during handler
+      const slots = new Array(capacity)
+      for (let i = 0; i < capacity; i++) {
+        slots[i] = new InputEvent(ring, binding.NCINPUT_RING_HEADER_SIZE + i * binding.NCINPUT_SIZE)
+      }
+
+      const onring = () => {
+        while (header[RING_TAIL] !== header[RING_HEAD]) {
+          const event = slots[header[RING_TAIL] & mask]
+          header[RING_TAIL]++
+          handler(event)
+        }
+      }
+
+      this.#inputRing = header
+      binding.inputStart(this.#handle, onring, miceEvents, INPUT_MODE_RING, ring)
+      return
+    }
+
+    if (opts.batch) {
+      const onbatch = batchHandle => {
+        handler(InputEvent.batch(batchHandle))
+      }
+
+      binding.inputStart(this.#handle, onbatch, miceEvents, INPUT_MODE_BATCH)
+      return
+    }
+
     function oninput (eventHandle) {
       handler(new InputEvent(eventHandle))
     }
 
-    binding.inputStart(this.#handle, oninput, miceEvents)
+    binding.inputStart(this.#handle, oninput, miceEvents, INPUT_MODE_EVENT)
+  }
+
+  /** amount of input events discarded due to a full input ring */
+  get inputDropped () {
+    return this.#inputRing ? this.#inputRing[RING_DROPPED] : 0
   }
 
   inputStop () {
     binding.inputStop(this.#handle)
+    this.#inputRing = null
   }
 
   render () {
+    if (this.rendering) throw new Error('render in flight')
     return binding.render(this.#handle)
   }
 
+  /**
+   * Render and rasterize on a worker thread,
+   * planes of the standard pile must not be modified until resolved.
+   * @returns {Promise<void>}
+   */
+  renderAsync () {
+    if (this.rendering) return Promise.reject(new Error('render in flight'))
+
+    this.#rendering = new Promise((resolve, reject) => {
+      binding.renderAsync(this.#handle, status => {
+        this.#rendering = null
+
+        if (status !== 0) reject(new Error('render failed'))
+        else resolve()
+      })
+    })
+
+    return this.#rendering
+  }
+
+  /**
+   * Request a frame, all requests until the next
+   * frame interval are coalesced into a single render.
+   */
+  requestRender () {
+    if (!this.#scheduled) this.setMaxFps(this.#maxFps)
+
+    binding.requestRender(this.#handle)
+  }
+
+  /** Limit the rate of frames rendered by `requestRender()` */
+  setMaxFps (fps) {
+    if (!(fps > 0)) throw new Error('expected positive fps')
+
+    const onframe = status => {
+      if (this.#onframe) this.#onframe(status)
+    }
+
+    this.#maxFps = fps
+    this.#scheduled = true
+
+    // rates past 1000fps are clamped to the 1ms timer resolution
+    binding.renderSchedule(this.#handle, Math.max(1, Math.round(1000 / fps)), onframe)
+  }
+
+  /** @type {(status: number) => void} called after each scheduled frame */
+  get onframe () {
+    return this.#onframe
+  }
+
+  set onframe (fn) {
+    this.#onframe = fn
+  }
+
+  /**
+   * Read notcurses' render statistics
+   * @param {Float64Array} [target] filled in `Notcurses.STATS_FIELDS` order instead of returning an object
+   */
+  stats (target) {
+    return this.#stats(target, false)
+  }
+
+  /** Same as `stats()` but returns the values before resetting them */
+  resetStats (target) {
+    return this.#stats(target, true)
+  }
+
+  #stats (target, reset) {
+    if (target) {
+      if (!(target instanceof Float64Array) || target.length < STATS_FIELDS.length) throw new Error('expected Float64Array of STATS_FIELDS.length')
+
+      binding.stats(this.#handle, target.buffer, target.byteOffset, reset)
+      return target
+    }
+
+    const values = new Float64Array(STATS_FIELDS.length)
+    binding.stats(this.#handle, values.buffer, 0, reset)
+
+    const stats = {}
+    for (let i = 0; i < STATS_FIELDS.length; i++) stats[STATS_FIELDS[i]] = values[i]
+
+    return stats
+  }
+
+  static STATS_FIELDS = STATS_FIELDS
+
+  /**
+   * Render the standard pile into a buffer instead of the terminal
+   * @param {Buffer} [target] reusable output buffer
+   * @returns {Buffer} frame, a slice of target when it fits
+   */
+  renderToBuffer (target) {
+    if (this.rendering) throw new Error('render in flight')
+    return this.stdplane.renderToBuffer(target)
+  }
+
+  /**
+   * Output written since last read, requires `{ sink: 'memory' }`
+   * @returns {Buffer}
+   */
+  readOutput () {
+    return Buffer.from(binding.readSink(this.#handle))
+  }
+
+  /**
+   * Render several piles concurrently on worker threads
+   * @param {Plane[]} piles
+   */
+  renderPiles (piles) {
+    return Promise.all(piles.map(pile => pile.renderAsync()))
+  }
+
+  /**
+   * Memory budget in bytes of the cache behind `visual.blitCached()`,
+   * least recently used results are evicted beyond it.
+   */
+  setBitmapCacheBudget (bytes) {
+    if (!(bytes >= 0)) throw new Error('expected non-negative budget')
+    binding.visualCacheBudget(this.#handle, bytes)
+  }
+
+  /** Drops all cached blits, including those currently displayed */
+  clearBitmapCache () {
+    binding.visualCacheClear(this.#handle)
+  }
+
+  /** @returns {{ entries: number, bytes: number, budget: number, hits: number, misses: number, evictions: number }} */
+  get bitmapCache () {
+    return binding.visualCacheStats(this.#handle)
+  }
+
+  /** `true` while an async render, of any pile, is in flight */
+  get rendering () {
+    if (this.#handle === null) return false
+    return !!this.#rendering || binding.pileRenders(this.#handle) > 0
+  }
+
   destroy () {
     if (this.#handle == null) throw new Error('already destroyed')
+    if (this.rendering) throw new Error('render in flight')
+    if (binding.blitsInFlight(this.#handle) > 0) throw new Error('blit in flight')
 
     binding.destroy(this.#handle)
     this.#handle = null
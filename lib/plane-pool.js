@@ -0,0 +1,106 @@
+const binding = require('../binding')
+const Plane = require('./plane')
+
+/** @typedef {import('./notcurses')} Notcurses */
+
+class PlanePool {
+  #free = []
+  #max
+  #hits = 0
+  #misses = 0
+
+  /** @param {object} opts `{ max }` planes kept for reuse */
+  constructor (opts = {}) {
+    this.#max = opts.max ?? 64
+  }
+
+  /**
+   * Hands out a recycled plane when one is parked, creates one otherwise
+   * @param {Plane|Notcurses} parent
+   * @param {object} opts `{ y, x, rows, cols }`
+   * @returns {Plane}
+   */
+  acquire (parent, opts = {}) {
+    const {
+      y = 0,
+      x = 0,
+      rows = 1,
+      cols = 1
+    } = opts
+
+    if (!(parent instanceof Plane)) parent = parent.stdplane
+
+    const plane = this.#free.pop()
+
+    if (plane === undefined) {
+      this.#misses++
+      return new Plane(parent, { y, x, rows, cols })
+    }
+
+    this.#hits++
+    binding.planeAcquire(plane._handle, parent._handle, y, x, rows, cols)
+
+    return plane
+  }
+
+  /**
+   * Parks the plane for reuse, it is destroyed when the pool is full.
+   * The plane must not be used until acquired again
+   * @param {Plane} plane
+   * @returns {boolean} true when parked
+   */
+  release (plane) {
+    if (this.#free.includes(plane)) throw new Error('already released')
+    if (plane.rendering) throw new Error('render in flight')
+    if (binding.planeBlitTarget(plane._handle, false)) throw new Error('blit in flight')
+
+    if (this.#free.length >= this.#max) {
+      plane.destroy()
+      return false
+    }
+
+    binding.planeRelease(plane._handle)
+    this.#free.push(plane)
+
+    return true
+  }
+
+  /** planes parked for reuse */
+  get size () {
+    return this.#free.length
+  }
+
+  get max () {
+    return this.#max
+  }
+
+  set max (max) {
+    this.#max = max
+    while (this.#free.length > max) this.#free.pop().destroy()
+  }
+
+  get hits () {
+    return this.#hits
+  }
+
+  get misses () {
+    return this.#misses
+  }
+
+  get hitRate () {
+    const total = this.#hits + this.#misses
+    return total === 0 ? 0 : this.#hits / total
+  }
+
+  resetStats () {
+    this.#hits = 0
+    this.#misses = 0
+  }
+
+  /** destroys all parked planes */
+  clear () {
+    while (this.#free.length > 0) this.#free.pop().destroy()
+  }
+}
+
+module.exports = PlanePool
@@ -1,24 +1,52 @@
 const binding = require('../binding')
-const { NCSTYLE_NONE } = require('./constants')
+const { NCSTYLE_NONE, NCALIGN_LEFT } = require('./constants')
 const Channels = require('./channels')
 const { inspect } = require('./util')
 
 /** @typedef {import('./notcurses')} Notcurses */
 
+const EMPTY = Buffer.alloc(0)
+const RENDER_FAILED = -0x80000000
+
+// must match bare_ncplane_state_t in binding.cc
+const STATE_Y = 0
+const STATE_X = 1
+const STATE_DIM_Y = 2
+const STATE_DIM_X = 3
+const STATE_CURSOR_Y = 4
+const STATE_CURSOR_X = 5
+const STATE_STYLES = 6
+const STATE_FCHANNEL = 7
+const STATE_BCHANNEL = 8
+const STATE_LENGTH = binding.NCPLANE_STATE_SIZE / 4
+
+const puttext = new Uint32Array(2) // rows, bytes
+
+// Plane of each handle, the binding hands out one handle per native plane
+const wrappers = new WeakMap()
+
 class Plane {
   #handle
   #channels
+  #state // Int32Array view of the native state block
+  #ustate // same memory, unsigned
 
   /** @param {Plane} parent */
   constructor (parent, opts = {}) {
     // plane allocated elswhere, wrap handle
     if (opts instanceof ArrayBuffer) {
       this.#handle = opts
+      this.#bindState()
+      this.refresh()
+      wrappers.set(opts, this)
       return
     }
 
     // Allocate from opts
 
+    // a Notcurses parent stands for its standard plane
+    if (!(parent instanceof Plane)) parent = parent.stdplane
+
     opts.rows ||= opts.height
     opts.cols ||= opts.width
 
@@ -48,6 +76,23 @@ class Plane {
       name,
       onresize
     )
+
+    this.#bindState()
+    wrappers.set(this.#handle, this)
+  }
+
+  #bindState () {
+    this.#state = new Int32Array(this.#handle, binding.NCPLANE_STATE_OFFSET, STATE_LENGTH)
+    this.#ustate = new Uint32Array(this.#handle, binding.NCPLANE_STATE_OFFSET, STATE_LENGTH)
+  }
+
+  /**
+   * Reread geometry, cursor and style from notcurses.
+   * Rarely needed, the state follows every call through the
+   * binding and resizes notcurses applies to the plane.
+   */
+  refresh () {
+    binding.planeSyncState(this.#handle)
   }
 
   get _handle () { // oops
@@ -55,7 +100,7 @@ class Plane {
   }
 
   get y () {
-    return binding.getPlaneY(this.#handle)
+    return this.#state[STATE_Y]
   }
 
   set y (value) {
@@ -63,7 +108,7 @@ class Plane {
   }
 
   get x () {
-    return binding.getPlaneX(this.#handle)
+    return this.#state[STATE_X]
   }
 
   set x (value) {
@@ -71,11 +116,11 @@ class Plane {
   }
 
   get dimY () {
-    return binding.getPlaneDimY(this.#handle)
+    return this.#ustate[STATE_DIM_Y]
   }
 
   get dimX () {
-    return binding.getPlaneDimX(this.#handle)
+    return this.#ustate[STATE_DIM_X]
   }
 
   get name () {
@@ -87,7 +132,7 @@ class Plane {
   }
 
   get cursorY () {
-    return binding.getPlaneCursorY(this.#handle)
+    return this.#ustate[STATE_CURSOR_Y]
   }
 
   set cursorY (value) {
@@ -96,7 +141,7 @@ class Plane {
   }
 
   get cursorX () {
-    return binding.getPlaneCursorX(this.#handle)
+    return this.#ustate[STATE_CURSOR_X]
   }
 
   set cursorX (value) {
@@ -105,7 +150,7 @@ class Plane {
   }
 
   get styles () {
-    return binding.getPlaneStyles(this.#handle)
+    return this.#ustate[STATE_STYLES]
   }
 
   set styles (ncstyle) {
@@ -116,8 +161,9 @@ class Plane {
   get channels () {
     if (!this.#channels) {
       this.#channels = new Channels({
-        get: () => binding.getPlaneChannels(this.#handle),
-        set: v => { this.channels = v }
+        getFg: () => this.#ustate[STATE_FCHANNEL],
+        getBg: () => this.#ustate[STATE_BCHANNEL],
+        set: (fg, bg) => binding.setPlaneChannels(this.#handle, fg, bg)
       })
     }
 
@@ -126,8 +172,7 @@ class Plane {
 
   set channels (value) {
     // TODO: bug; plane.channels = a; plane.chanenls === a; => false
-    const bn = Channels.from(value).value
-    binding.setPlaneChannels(this.#handle, bn)
+    binding.setPlaneChannels(this.#handle, Channels.fgOf(value), Channels.bgOf(value))
   }
 
   move (y, x) {
@@ -142,16 +187,47 @@ class Plane {
     binding.planeErase(this.#handle)
   }
 
-  setBase (egc = ' ', styles = NCSTYLE_NONE, channels = 0n) {
-    binding.planeSetBase(this.#handle, egc, styles, Channels.from(channels).value)
+  setBase (egc = ' ', styles = NCSTYLE_NONE, channels = 0) {
+    const fg = Channels.fgOf(channels)
+    const bg = Channels.bgOf(channels)
+
+    if (ArrayBuffer.isView(egc)) {
+      binding.planeSetBaseUtf8(this.#handle, egc.buffer, egc.byteOffset, egc.byteLength, styles, fg, bg)
+    } else {
+      binding.planeSetBase(this.#handle, egc, styles, fg, bg)
+    }
   }
 
   putstr (str, y = -1, x = -1) {
+    if (ArrayBuffer.isView(str)) {
+      return binding.planePutnstrYX(this.#handle, y, x, str.buffer, str.byteOffset, str.byteLength)
+    }
+
     return binding.planePutstrYX(this.#handle, y, x, str)
   }
 
-  vline (egc, len, styles = NCSTYLE_NONE, channels = 0n) {
-    return binding.planeVLine(this.#handle, egc, len, styles, Channels.from(channels).value)
+  /**
+   * Word wraps and aligns text starting at row `y`
+   * @param {string|Uint8Array} text UTF-8
+   * @returns {{ rows: number, bytes: number, cols: number }}
+   */
+  putText (text, y = -1, align = NCALIGN_LEFT) {
+    if (!ArrayBuffer.isView(text)) text = Buffer.from(text)
+
+    const cols = binding.planePutText(this.#handle, y, align, text.buffer, text.byteOffset, text.byteLength, puttext.buffer, puttext.byteOffset)
+
+    return { rows: puttext[0], bytes: puttext[1], cols }
+  }
+
+  vline (egc, len, styles = NCSTYLE_NONE, channels = 0) {
+    const fg = Channels.fgOf(channels)
+    const bg = Channels.bgOf(channels)
+
+    if (ArrayBuffer.isView(egc)) {
+      return binding.planeVLineUtf8(this.#handle, egc.buffer, egc.byteOffset, egc.byteLength, len, styles, fg, bg)
+    }
+
+    return binding.planeVLine(this.#handle, egc, len, styles, fg, bg)
   }
 
   cursorMove (y = -1, x = -1) {
@@ -180,23 +256,215 @@ class Plane {
     return binding.planeMergedown(this.#handle, dstPlane.#handle)
   }
 
-  perimeterRounded (styleMask = NCSTYLE_NONE, channels = 0n, ctlword = 0) {
-    return binding.planePerimeter(this.#handle, 0, styleMask, Channels.from(channels).value, ctlword)
+  perimeterRounded (styleMask = NCSTYLE_NONE, channels = 0, ctlword = 0) {
+    return binding.planePerimeter(this.#handle, 0, styleMask, Channels.fgOf(channels), Channels.bgOf(channels), ctlword)
+  }
+
+  perimeterDouble (styleMask = NCSTYLE_NONE, channels = 0, ctlword = 0) {
+    return binding.planePerimeter(this.#handle, 1, styleMask, Channels.fgOf(channels), Channels.bgOf(channels), ctlword)
+  }
+
+  /**
+   * Replay all ops recorded in a CommandBuffer
+   * @param {import('./command-buffer')} commands
+   * @returns {number} amount of ops executed
+   */
+  exec (commands) {
+    return commands._exec(this.#handle)
+  }
+
+  /**
+   * Write a grid of cells in a single native call
+   * @param {Uint32Array} codepoints one per cell, 0 skips cell
+   * @param {Uint16Array} [styles] stylemask per cell
+   * @param {BigUint64Array|Uint32Array} [channels] per cell, as u64 or [bg, fg] u32 pairs
+   * @returns {number} amount of cells written
+   */
+  putCells (y, x, rows, cols, codepoints, styles, channels) {
+    const cells = rows * cols
+    if (!(codepoints instanceof Uint32Array) || codepoints.length < cells) throw new Error('expected Uint32Array of rows * cols codepoints')
+    if (styles && (!(styles instanceof Uint16Array) || styles.length < cells)) throw new Error('expected Uint16Array of rows * cols styles')
+    if (channels && (!ArrayBuffer.isView(channels) || channels.byteLength < cells * 8)) throw new Error('expected 64bit channels per cell')
+
+    return binding.planePutCells(
+      this.#handle,
+      y, x, rows, cols,
+      codepoints.buffer, codepoints.byteOffset,
+      styles?.buffer, styles?.byteOffset || 0,
+      channels?.buffer, channels?.byteOffset || 0
+    )
+  }
+
+  /**
+   * Render the plane's pile and write the escape sequences
+   * of the frame into target
+   * @param {Buffer} [target] reusable output buffer
+   * @returns {Buffer} frame, a slice of target when it fits
+   */
+  renderToBuffer (target = EMPTY) {
+    return this.#toBuffer(target, true)
+  }
+
+  /**
+   * Same as `renderToBuffer()` but skips rendering,
+   * for piles already rendered by `renderAsync()`
+   */
+  rasterizeToBuffer (target = EMPTY) {
+    return this.#toBuffer(target, false)
+  }
+
+  #toBuffer (target, render) {
+    if (this.rendering) throw new Error('render in flight')
+
+    let len = binding.pileRenderToBuffer(this.#handle, target.buffer, target.byteOffset, target.byteLength, render)
+
+    if (len < 0 && len !== RENDER_FAILED) {
+      // frame is retained natively until read
+      target = Buffer.allocUnsafe(-len)
+      len = binding.pileRenderToBuffer(this.#handle, target.buffer, target.byteOffset, target.byteLength, false)
+    }
+
+    if (len < 0) throw new Error('render failed')
+
+    return target.subarray(0, len)
+  }
+
+  /** Topmost plane of this plane's pile */
+  get pileTop () {
+    return Plane.from(binding.pileTop(this.#handle))
+  }
+
+  /** Bottommost plane of this plane's pile */
+  get pileBottom () {
+    return Plane.from(binding.pileBottom(this.#handle))
   }
 
-  perimeterDouble (styleMask = NCSTYLE_NONE, channels = 0n, ctlword = 0) {
-    return binding.planePerimeter(this.#handle, 1, styleMask, Channels.from(channels).value, ctlword)
+  /** `true` while an async render of the plane's pile is in flight */
+  get rendering () {
+    return binding.pileRendering(this.#handle)
+  }
+
+  /** Render the plane's pile */
+  render () {
+    if (this.rendering) throw new Error('render in flight')
+    return binding.pileRender(this.#handle)
+  }
+
+  /** Write the plane's rendered pile to the terminal, making it visible */
+  rasterize () {
+    if (this.rendering) throw new Error('render in flight')
+    return binding.pileRasterize(this.#handle)
+  }
+
+  /**
+   * Render the plane's pile on a worker thread,
+   * distinct piles can be rendered concurrently.
+   * @returns {Promise<void>}
+   */
+  renderAsync () {
+    if (this.rendering) return Promise.reject(new Error('render in flight'))
+
+    return new Promise((resolve, reject) => {
+      binding.pileRenderAsync(this.#handle, status => {
+        if (status !== 0) reject(new Error('render failed'))
+        else resolve()
+      })
+    })
+  }
+
+  /** @returns {Plane} the Plane already wrapping handle, or a new one */
+  static from (handle) {
+    return wrappers.get(handle) || new Plane(null, handle)
+  }
+
+  /**
+   * Create a plane as root of a new pile
+   * @param {Notcurses} notcurses
+   */
+  static pile (notcurses, opts = {}) {
+    let onresize
+    let plane = null
+
+    if (typeof opts.onresize === 'function') {
+      onresize = () => opts.onresize(plane)
+    }
+
+    const handle = binding.pileCreate(
+      notcurses._handle,
+      opts.rows || opts.height || 0,
+      opts.cols || opts.width || 0,
+      opts.name,
+      onresize
+    )
+
+    plane = new Plane(null, handle)
+    return plane
   }
 
   contents (x = -1, y = -1, lenX = 0, lenY = 0) {
     return binding.planeContents(this.#handle, x, y, lenX, lenY)
   }
 
+  /**
+   * Copy a region of cells into typed arrays in one native pass.
+   * The text of cell `i` is `text.subarray(offsets[i], offsets[i + 1])`.
+   * @param {object} [target] previous snapshot, its arrays are reused
+   * @returns {{ rows: number, cols: number, text: Buffer, offsets: Uint32Array, styles: Uint16Array, channels: Uint32Array }}
+   */
+  snapshot (target = null, y = 0, x = 0, rows = this.dimY - y, cols = this.dimX - x) {
+    const cells = rows * cols
+
+    target ||= {}
+    target.rows = rows
+    target.cols = cols
+
+    if (!target.offsets || target.offsets.length < cells + 1) target.offsets = new Uint32Array(cells + 1)
+    if (!target.styles || target.styles.length < cells) target.styles = new Uint16Array(cells)
+    if (!target.channels || target.channels.length < cells * 2) target.channels = new Uint32Array(cells * 2)
+
+    // mostly single byte cells, grows once when wider text shows up
+    let text = target._text
+    if (!text || text.byteLength < cells) text = Buffer.allocUnsafe(cells * 4)
+
+    let len = this.#snapshot(target, text, y, x, rows, cols)
+
+    if (len < 0) {
+      text = Buffer.allocUnsafe(-len)
+      len = this.#snapshot(target, text, y, x, rows, cols)
+    }
+
+    target._text = text
+    target.text = text.subarray(0, len)
+
+    return target
+  }
+
+  #snapshot (target, text, y, x, rows, cols) {
+    const { offsets, styles, channels } = target
+
+    return binding.planeSnapshot(
+      this.#handle,
+      y, x, rows, cols,
+      text.buffer, text.byteOffset, text.byteLength,
+      offsets.buffer, offsets.byteOffset,
+      styles.buffer, styles.byteOffset,
+      channels.buffer, channels.byteOffset
+    )
+  }
+
   get pixelGeom () {
     return binding.planePixelGeom(this._handle)
   }
 
+  // the native plane was destroyed elsewhere, e.g. along with its plot
+  _invalidate () {
+    this.#handle = null
+  }
+
   destroy (family = false) {
+    if (this.#handle === null) throw new Error('already destroyed')
+    if (binding.planeBlitTarget(this.#handle, family)) throw new Error('blit in flight')
+
     if (family) binding.planeFamilyDestroy(this.#handle)
     else binding.planeDestroy(this.#handle)
 
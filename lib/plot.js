@@ -0,0 +1,117 @@
+const binding = require('../binding')
+const Plane = require('./plane')
+const Channels = require('./channels')
+const { NCSTYLE_NONE, NCBLIT_DEFAULT } = require('./constants')
+
+// must match BARE_NCPLOT_* in binding.cc
+const PLOT_UINT = 0
+const PLOT_DOUBLE = 1
+
+class Plot {
+  #plane
+  #handle
+  #double
+
+  /**
+   * Plots samples into a plane of its own, created under `parent`
+   * @param {Plane} parent
+   * @param {object} opts plane geometry and plot options
+   */
+  constructor (parent, opts = {}) {
+    const {
+      type = 'uint',
+      min = 0,
+      max = 0,
+      minChannels = 0,
+      maxChannels = 0,
+      legendStyle = NCSTYLE_NONE,
+      blitter = NCBLIT_DEFAULT,
+      rangex = 0,
+      title = null,
+      flags = 0
+    } = opts
+
+    if (type !== 'uint' && type !== 'double') throw new Error('unsupported plot type: ' + type)
+
+    this.#double = type === 'double'
+    this.#plane = new Plane(parent, {
+      y: opts.y,
+      x: opts.x,
+      rows: opts.rows,
+      cols: opts.cols,
+      name: opts.name
+    })
+
+    this.#handle = binding.plotCreate(
+      this.#plane._handle,
+      this.#double ? PLOT_DOUBLE : PLOT_UINT,
+      Number(min),
+      Number(max),
+      Channels.fgOf(minChannels),
+      Channels.bgOf(minChannels),
+      Channels.fgOf(maxChannels),
+      Channels.bgOf(maxChannels),
+      legendStyle,
+      blitter,
+      rangex,
+      title,
+      flags
+    )
+
+    if (!this.#handle) {
+      this.#plane._invalidate()
+      throw new Error('plot creation failed')
+    }
+  }
+
+  /** plane drawn into, owned and destroyed by the plot */
+  get plane () {
+    return this.#plane
+  }
+
+  /**
+   * Adds samples to consecutive slots starting at `x`
+   * @param {number} x
+   * @param {BigUint64Array|Float64Array} samples BigUint64Array for uint plots
+   * @returns {number} samples taken
+   */
+  addSamples (x, samples) {
+    return this.#samples(x, samples, false)
+  }
+
+  /** Like `addSamples()` but replaces the slot values */
+  setSamples (x, samples) {
+    return this.#samples(x, samples, true)
+  }
+
+  addSample (x, y) {
+    return this.#samples(x, this.#double ? Float64Array.of(y) : BigUint64Array.of(BigInt(y)), false) === 1
+  }
+
+  setSample (x, y) {
+    return this.#samples(x, this.#double ? Float64Array.of(y) : BigUint64Array.of(BigInt(y)), true) === 1
+  }
+
+  /** @returns {number|null} value of slot `x`, null when outside the window */
+  sample (x) {
+    return binding.plotSample(this.#handle, x) ?? null
+  }
+
+  #samples (x, samples, set) {
+    if (!(samples instanceof (this.#double ? Float64Array : BigUint64Array))) {
+      throw new Error(this.#double ? 'expected Float64Array' : 'expected BigUint64Array')
+    }
+
+    return binding.plotSamples(this.#handle, this.#plane._handle, x, samples.buffer, samples.byteOffset, samples.length, set)
+  }
+
+  destroy () {
+    if (binding.planeBlitTarget(this.#plane._handle, false)) throw new Error('blit in flight')
+
+    binding.plotDestroy(this.#handle, this.#plane._handle)
+    this.#plane._invalidate()
+    this.#handle = null
+  }
+}
+
+module.exports = Plot
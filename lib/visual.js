@@ -2,20 +2,106 @@ const binding = require('../binding')
 const Plane = require('./plane')
 const {
   NCSCALE_STRETCH,
-  NCBLIT_DEFAULT
+  NCBLIT_DEFAULT,
+  NCBLIT_1x1,
+  NCBLIT_2x1,
+  NCBLIT_2x2,
+  NCBLIT_3x2,
+  NCBLIT_4x2,
+  NCBLIT_BRAILLE,
+  NCBLIT_PIXEL,
+  NCBLIT_4x1,
+  NCBLIT_8x1
 } = require('./constants')
 
 /** @typedef {import('./notcurses')} Notcurses */
 
+// must match BARE_NCVISUAL_* in binding.cc
+const FORMATS = {
+  rgba: { id: 0, bpp: 4 },
+  rgb: { id: 1, bpp: 3 },
+  bgra: { id: 2, bpp: 4 },
+  palidx: { id: 3, bpp: 1 }
+}
+
+// pixels per cell as [rows, cols]
+const BLITTER_CELL = {
+  [NCBLIT_1x1]: [1, 1],
+  [NCBLIT_2x1]: [2, 1],
+  [NCBLIT_2x2]: [2, 2],
+  [NCBLIT_3x2]: [3, 2],
+  [NCBLIT_4x2]: [4, 2],
+  [NCBLIT_BRAILLE]: [4, 2],
+  [NCBLIT_4x1]: [4, 1],
+  [NCBLIT_8x1]: [8, 1]
+}
+
+// constructs a Visual around an existing native handle
+const HANDLE = Symbol('handle')
+
+// must match BARE_PNG_* in binding.cc
+const PNG_ERRORS = {
+  [-1]: 'malformed png',
+  [-2]: 'unsupported png'
+}
+
 class Visual {
   #nc
   #handle
+  #width
+  #height
+  #palette = null
+  #target = null
+  #blitting = null
+  #blitPlane = null
+
+  /**
+   * @param {Notcurses} notcurses
+   * @param {number|object} opts bytes per pixel or `{ format, stride, palette, scaleTo, blitter }`
+   */
+  constructor (notcurses, data, width, height, opts = {}) {
+    if (data === HANDLE) {
+      this.#nc = notcurses
+      this.#handle = opts
+      this.#width = width
+      this.#height = height
+      return
+    }
 
-  /** @param {Notcurses} notcurses */
-  constructor (notcurses, data, width, height, bytesPerPixel = 4) {
-    if (!Buffer.isBuffer(data)) throw new Error('expected buffer')
+    if (!ArrayBuffer.isView(data)) throw new Error('expected buffer')
+
+    // legacy bytesPerPixel argument
+    if (typeof opts === 'number') opts = { format: opts === 3 ? 'rgb' : 'rgba' }
+
+    const format = FORMATS[opts.format || 'rgba']
+    if (!format) throw new Error('unsupported format: ' + opts.format)
+
+    const { palette } = opts
+    if (format === FORMATS.palidx) checkPalette(palette)
 
     this.#nc = notcurses
+    this.#palette = palette || null
+    this.#width = width
+    this.#height = height
+
+    const scaled = opts.scaleTo && scaleGeom(notcurses, opts.scaleTo, opts.blitter, width, height)
+
+    if (scaled) {
+      if (format.bpp !== 4) throw new Error('scaleTo requires rgba or bgra')
+
+      this.#handle = binding.visualCreateScaled(
+        data.buffer,
+        data.byteOffset,
+        data.byteLength,
+        width,
+        height,
+        format.id,
+        opts.stride || 0,
+        scaled.width,
+        scaled.height
+      )
+      return
+    }
 
     this.#handle = binding.visualCreate(
       data.buffer,
@@ -23,12 +109,81 @@ class Visual {
       data.byteLength,
       width,
       height,
-      bytesPerPixel
+      format.bpp,
+      format.id,
+      opts.stride || 0,
+      palette?.buffer,
+      palette?.byteOffset || 0,
+      palette?.length || 0
     )
+
+    if (!this.#handle) throw new Error(format === FORMATS.palidx ? 'palette index out of range' : 'invalid pixels')
   }
 
   /**
-   * @param {Plane} dstPlane
+   * Decode a PNG natively on a worker thread,
+   * pixels never pass through JS memory.
+   * Interlaced images are not supported.
+   * @param {Notcurses} notcurses
+   * @param {Uint8Array} data encoded png, must not be mutated until resolved
+   * @returns {Promise<Visual>}
+   */
+  static fromPNG (notcurses, data) {
+    if (!ArrayBuffer.isView(data)) return Promise.reject(new Error('expected buffer'))
+
+    return new Promise((resolve, reject) => {
+      const handle = binding.visualDecodePNG(
+        data.buffer,
+        data.byteOffset,
+        data.byteLength,
+        (status, width, height) => {
+          if (status !== 0) return reject(new Error(PNG_ERRORS[status] || 'png decode failed'))
+
+          resolve(new Visual(notcurses, HANDLE, width, height, handle))
+        }
+      )
+    })
+  }
+
+  /** Width in pixels of the source */
+  get width () {
+    return this.#width
+  }
+
+  /** Height in pixels of the source */
+  get height () {
+    return this.#height
+  }
+
+  /**
+   * Replace the pixels, geometry and format must remain the same.
+   * Call `blit()` to redraw.
+   * @param {Uint32Array} [palette] new palette for 'palidx' visuals
+   */
+  update (data, palette = this.#palette) {
+    if (!ArrayBuffer.isView(data)) throw new Error('expected buffer')
+    if (this.#blitting) throw new Error('blit in flight')
+    if (this.#palette) checkPalette(palette)
+
+    const updated = binding.visualUpdate(
+      this.#handle,
+      data.buffer,
+      data.byteOffset,
+      data.byteLength,
+      palette?.buffer,
+      palette?.byteOffset || 0,
+      palette?.length || 0
+    )
+
+    if (!updated) throw new Error('palette index out of range')
+
+    this.#palette = palette
+  }
+
+  /**
+   * Blit onto dstPlane, when omitted the previous
+   * destination and options are reused.
+   * @param {Plane} [dstPlane]
    */
   blit (dstPlane, scaling = NCSCALE_STRETCH, blitter = NCBLIT_DEFAULT, flags = 0) {
     // TODO: the disabled lines in this function refer to
@@ -37,15 +192,25 @@ class Visual {
 
     // this.plane = this.plane || dstPlane || undefined
 
+    if (dstPlane) {
+      this.#target = { plane: dstPlane, scaling, blitter, flags }
+    } else if (this.#target && arguments.length > 1) {
+      // redraw onto the previous plane with new options
+      this.#target = { plane: this.#target.plane, scaling, blitter, flags }
+    }
+
+    const target = this.#target
+    if (!target) throw new Error('expected destination plane')
+
     binding.visualBlit(
       this.#nc._handle,
       this.#handle,
-      dstPlane._handle, // this.plane && this.plane._handle,
+      target.plane._handle, // this.plane && this.plane._handle,
       0, // y
       0, // x
-      scaling,
-      blitter,
-      flags
+      target.scaling,
+      target.blitter,
+      target.flags
     )
 
     /*
@@ -56,9 +221,76 @@ class Visual {
     */
   }
 
+  /**
+   * Same as `blit()` but the result is cached by content, geometry
+   * and options, blitting unchanged content again only reattaches
+   * the previously encoded bitmap to dstPlane.
+   * @param {Plane} dstPlane
+   * @returns {boolean} `true` when served from the cache
+   */
+  blitCached (dstPlane, scaling = NCSCALE_STRETCH, blitter = NCBLIT_DEFAULT, flags = 0) {
+    if (this.#blitting) throw new Error('blit in flight')
+
+    const res = binding.visualBlitCached(
+      this.#nc._handle,
+      this.#handle,
+      dstPlane._handle,
+      scaling,
+      blitter,
+      flags
+    )
+
+    if (res < 0) throw new Error('blit failed')
+
+    return res === 1
+  }
+
+  /**
+   * Scale and encode on a worker thread, the result is attached
+   * to dstPlane as a child plane once done and replaces
+   * the result of the previous async blit.
+   * The visual must not be updated or destroyed until resolved.
+   * @param {Plane} dstPlane
+   * @returns {Promise<Plane>} child plane holding the blit
+   */
+  blitAsync (dstPlane, scaling = NCSCALE_STRETCH, blitter = NCBLIT_DEFAULT, flags = 0) {
+    if (this.#blitting) return Promise.reject(new Error('blit in flight'))
+
+    this.#blitting = new Promise((resolve, reject) => {
+      const handle = binding.visualBlitAsync(
+        this.#nc._handle,
+        this.#handle,
+        dstPlane._handle,
+        scaling,
+        blitter,
+        flags,
+        status => {
+          this.#blitting = null
+
+          if (status !== 0) return reject(new Error('blit failed'))
+
+          if (this.#blitPlane) this.#blitPlane.destroy()
+          this.#blitPlane = new Plane(null, handle)
+
+          resolve(this.#blitPlane)
+        }
+      )
+    })
+
+    return this.#blitting
+  }
+
   destroy () {
+    if (this.#blitting) throw new Error('blit in flight')
+
+    if (this.#blitPlane) {
+      this.#blitPlane.destroy()
+      this.#blitPlane = null
+    }
+
     binding.visualDestroy(this.#handle)
     this.#handle = null
+    this.#target = null
 
     if (this.plane) {
       this.plane.destroy()
@@ -69,4 +301,43 @@ class Visual {
   [Symbol.dispose] () { this.destroy() }
 }
 
+function checkPalette (palette) {
+  if (!(palette instanceof Uint32Array)) throw new Error('expected Uint32Array palette')
+  if (palette.length === 0 || palette.length > 256) throw new Error('expected 1 to 256 palette entries')
+}
+
+/**
+ * Geometry covering the pixels plane can display with blitter,
+ * keeps the aspect ratio, null when no downscale is needed.
+ * @param {Notcurses} nc
+ * @param {Plane} plane
+ */
+function scaleGeom (nc, plane, blitter = NCBLIT_DEFAULT, width, height) {
+  if (blitter === NCBLIT_DEFAULT) blitter = binding.visualMediaDefblitter(nc._handle, NCSCALE_STRETCH)
+
+  let rows = 0
+  let cols = 0
+
+  if (blitter === NCBLIT_PIXEL) {
+    const { pxy, pxx } = plane.pixelGeom
+    rows = pxy
+    cols = pxx
+  }
+
+  if (!rows || !cols) {
+    // pixel blits without pixel geometry degrade to 3x2
+    const [y, x] = BLITTER_CELL[blitter] || BLITTER_CELL[NCBLIT_3x2]
+    rows = plane.dimY * y
+    cols = plane.dimX * x
+  }
+
+  const ratio = Math.max(cols / width, rows / height)
+  if (ratio >= 1) return null
+
+  return {
+    width: Math.max(1, Math.ceil(width * ratio)),
+    height: Math.max(1, Math.ceil(height * ratio))
+  }
+}
+
 module.exports = Visual
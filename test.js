@@ -1,5 +1,5 @@
 const test = require('brittle')
-const { Notcurses, Plane, Channels } = require('.')
+const { Notcurses, Plane, Visual, Channels, CommandBuffer, LogView, Plot, PlanePool, NCSTYLE_BOLD, NCPLANE_OPTION_VSCROLL, NCSCALE_NONE, NCSCALE_STRETCH, NCBLIT_1x1, NCBLIT_PIXEL, NCVISUAL_OPTION_NODEGRADE, ncstrwidth, ncstrwidths } = require('.')
 
 // NOTE: without redirecting rendering
 // and synthesizing input events
@@ -78,6 +78,281 @@ test('create plane', t => {
   t.is(w2, 10)
 })
 
+test('plane state', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+  const plane = new Plane(nc, { y: 1, x: 2, rows: 3, cols: 10 })
+
+  t.alike([plane.y, plane.x, plane.dimY, plane.dimX], [1, 2, 3, 10], 'created')
+
+  plane.move(2, 4)
+  plane.resize(4, 12)
+  plane.putstr('hello', 1, 0)
+  plane.styles = NCSTYLE_BOLD
+  plane.channels.fgRgb = 0xff0000
+
+  const state = [plane.y, plane.x, plane.dimY, plane.dimX, plane.cursorY, plane.cursorX, plane.styles, plane.channels.fgRgb]
+
+  nc.destroy()
+
+  t.alike(state, [2, 4, 4, 12, 1, 5, NCSTYLE_BOLD, 0xff0000], 'synced on mutation')
+})
+
+test('plane state follows parent resize', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+  const parent = new Plane(nc, { rows: 10, cols: 10 })
+  const child = new Plane(parent, { marginBottom: 2, marginRight: 3 })
+
+  const before = [child.dimY, child.dimX]
+  parent.resize(20, 20)
+  const after = [child.dimY, child.dimX]
+
+  nc.destroy()
+
+  t.alike(before, [8, 7])
+  t.alike(after, [18, 17], 'no refresh needed')
+})
+
+test('plane snapshot', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+  const plane = new Plane(nc, { rows: 2, cols: 3 })
+
+  plane.styles = NCSTYLE_BOLD
+  plane.putstr('aé', 0, 0)
+  plane.styles = 0
+  plane.putstr('z', 1, 2)
+
+  const snap = plane.snapshot()
+  const again = plane.snapshot(snap)
+
+  const cell = i => snap.text.subarray(snap.offsets[i], snap.offsets[i + 1]).toString()
+  const cells = [cell(0), cell(1), cell(5)]
+  const styles = [snap.styles[0], snap.styles[5]]
+
+  nc.destroy()
+
+  t.is(again, snap, 'target reused')
+  t.alike(cells, ['a', 'é', 'z'])
+  t.alike(styles, [NCSTYLE_BOLD, 0])
+})
+
+test('utf8 buffers', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+  const plane = new Plane(nc, { rows: 3, cols: 4 })
+
+  const line = Buffer.from('>aé<')
+  const written = plane.putstr(line.subarray(1, 4), 0, 0) // slice without the markers
+  plane.vline(Buffer.from('|'), 2)
+
+  const snap = plane.snapshot()
+  const cell = i => snap.text.subarray(snap.offsets[i], snap.offsets[i + 1]).toString()
+  const cells = [cell(0), cell(1), cell(2), cell(6)]
+
+  nc.destroy()
+
+  t.is(written, 2)
+  t.alike(cells, ['a', 'é', '|', '|'])
+  t.is(ncstrwidth(line.subarray(1, 4)), 2)
+})
+
+test('plane putText', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+  const plane = new Plane(nc, { rows: 4, cols: 8 })
+
+  const text = Buffer.from('hello wide world')
+  const res = plane.putText(text, 0)
+
+  const snap = plane.snapshot()
+  const row = (snap, y) => snap.text.subarray(snap.offsets[y * 8], snap.offsets[y * 8 + 5]).toString().trim()
+  const lines = [row(snap, 0), row(snap, 1), row(snap, 2)]
+
+  const edge = plane.putText('abcdefgh', 3)
+
+  const small = new Plane(nc, { rows: 1, cols: 8 })
+  const cut = small.putText(text, 0)
+
+  const chat = new Plane(nc, { rows: 2, cols: 8, flags: NCPLANE_OPTION_VSCROLL })
+  const scrolled = chat.putText(text, 0)
+  const chatSnap = chat.snapshot()
+  const tail = [row(chatSnap, 0), row(chatSnap, 1)]
+
+  const wide = (snap, y) => snap.text.subarray(snap.offsets[y * snap.cols], snap.offsets[(y + 1) * snap.cols]).toString().trim()
+
+  const exact = new Plane(nc, { rows: 2, cols: 11 })
+  const fit = exact.putText('hello world foo', 0)
+  const exactSnap = exact.snapshot()
+  const fitted = [wide(exactSnap, 0), wide(exactSnap, 1)]
+
+  const emoji = new Plane(nc, { rows: 2, cols: 4 })
+  const family = emoji.putText('\u{1f468}\u200d\u{1f469}\u200d\u{1f467} ab', 0)
+  const emojiSnap = emoji.snapshot()
+  const clusters = [wide(emojiSnap, 0), wide(emojiSnap, 1)]
+
+  nc.destroy()
+
+  t.alike(res, { rows: 3, bytes: text.byteLength, cols: 14 })
+  t.alike(lines, ['hello', 'wide', 'world'])
+  t.is(edge.rows, 1, 'text ending at the right edge')
+  t.is(cut.rows, 1)
+  t.is(cut.bytes, 6, 'stops after the first row and its space')
+  t.is(cut.cols, -1)
+  t.alike([scrolled.rows, scrolled.bytes], [3, text.byteLength], 'scrolled rows counted')
+  t.alike(tail, ['wide', 'world'])
+  t.is(fit.rows, 2)
+  t.alike(fitted, ['hello world', 'foo'], 'word ending at the right edge')
+  t.is(family.rows, 2)
+  t.alike(clusters, ['\u{1f468}\u200d\u{1f469}\u200d\u{1f467}', 'ab'], 'grapheme cluster measured whole')
+})
+
+test('log view', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+  const plane = new Plane(nc, { rows: 2, cols: 6 })
+
+  const log = new LogView(plane, { lines: 3, bytes: 64 })
+
+  const appended = log.append('one\ntwo\r\nthree\nfour')
+  const rendered = log.render()
+  const again = log.render()
+
+  const snap = plane.snapshot()
+  const row = y => snap.text.subarray(snap.offsets[y * 6], snap.offsets[y * 6 + 5]).toString().trim()
+  const tail = [row(0), row(1)]
+
+  log.scrollBy(5)
+  const scroll = log.scroll
+  log.render()
+  plane.snapshot(snap)
+  const top = row(0)
+
+  const length = log.length
+
+  log.destroy()
+  nc.destroy()
+
+  t.is(appended, 4)
+  t.is(length, 3, 'oldest dropped')
+  t.is(rendered, true)
+  t.is(again, false, 'unchanged')
+  t.alike(tail, ['three', 'four'])
+  t.is(scroll, 2, 'clamped')
+  t.is(top, 'two')
+})
+
+test('log view evicts past scroll', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+  const plane = new Plane(nc, { rows: 2, cols: 6 })
+
+  const log = new LogView(plane, { lines: 8, bytes: 64 })
+
+  log.append('a\nb\nc\nd')
+  log.scrollBy(3)
+
+  log.append('x'.repeat(64) + '\n' + 'y'.repeat(64))
+
+  const length = log.length
+  const scroll = log.scroll
+  const rendered = log.render()
+
+  const snap = plane.snapshot()
+  const row = y => snap.text.subarray(snap.offsets[y * 6], snap.offsets[y * 6 + 5]).toString().trim()
+  const top = row(0)
+
+  log.destroy()
+  nc.destroy()
+
+  t.is(length, 1, 'arena sized line evicts the rest')
+  t.is(scroll, 0, 'clamped to the oldest line')
+  t.is(rendered, true)
+  t.is(top, 'yyyyy')
+})
+
+test('plot', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+
+  const plot = new Plot(nc, { rows: 3, cols: 10, type: 'double' })
+
+  const taken = plot.addSamples(0, Float64Array.of(1, 2.5, 4))
+  plot.setSample(1, 3)
+
+  const values = [plot.sample(0), plot.sample(1), plot.sample(2)]
+  const rows = plot.plane.dimY
+
+  t.exception(() => plot.addSamples(3, new Uint32Array(1)), /expected Float64Array/)
+
+  plot.destroy()
+  t.exception(() => plot.plane.destroy(), /already destroyed/)
+  nc.destroy()
+
+  t.is(taken, 3)
+  t.alike(values, [1, 3, 4])
+  t.is(rows, 3)
+})
+
+test('plane pool', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+  const parent = new Plane(nc, { rows: 10, cols: 10 })
+  const pool = new PlanePool({ max: 1 })
+
+  const a = pool.acquire(parent, { y: 1, rows: 1, cols: 4 })
+  a.putstr('row', 0, 0)
+  const parkedA = pool.release(a)
+
+  const b = pool.acquire(parent, { y: 2, x: 3, rows: 2, cols: 5 })
+  const geom = [b.y, b.x, b.dimY, b.dimX, b.cursorX]
+  const snap = b.snapshot()
+  const blank = snap.text.subarray(snap.offsets[0], snap.offsets[1]).toString().trim()
+
+  const c = pool.acquire(parent)
+  pool.release(b)
+  t.exception(() => pool.release(b), /already released/)
+  const parkedC = pool.release(c) // full
+
+  const { hits, misses, hitRate, size } = pool
+
+  pool.clear()
+  nc.destroy()
+
+  t.is(parkedA, true)
+  t.is(b, a, 'recycled')
+  t.alike(geom, [2, 3, 2, 5, 0])
+  t.is(blank, '', 'erased')
+  t.is(parkedC, false)
+  t.alike([hits, misses, hitRate, size], [1, 2, 1 / 3, 1])
+})
+
+test('plane pool recycles marginalized planes', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+  const parent = new Plane(nc, { rows: 10, cols: 10 })
+  const other = new Plane(nc, { rows: 10, cols: 10 })
+  const pool = new PlanePool({ max: 1 })
+
+  const child = new Plane(parent, { marginBottom: 2, marginRight: 3 })
+  pool.release(child)
+
+  const plane = pool.acquire(other, { rows: 2, cols: 3 })
+  other.resize(20, 20)
+  const dims = [plane.dimY, plane.dimX]
+
+  pool.clear()
+  nc.destroy()
+
+  t.is(plane, child)
+  t.alike(dims, [2, 3], 'no longer follows its parent')
+})
+
+test('batch widths', t => {
+  const strings = ['hello', 'größe', '日本', '', 'e\u0301x', 'a long ascii run past sixteen bytes']
+  const widths = ncstrwidths(strings)
+
+  t.alike(Array.from(widths), strings.map(s => ncstrwidth(s)))
+  t.alike(Array.from(widths), [5, 5, 4, 0, 2, 35])
+
+  const text = Buffer.from('ab日本')
+  const target = new Uint32Array(2)
+
+  t.is(ncstrwidths(text, new Uint32Array([0, 2, 8]), target), target, 'target reused')
+  t.alike(Array.from(target), [2, 4])
+})
+
 test('ncchannels', t => {
   const c = new Channels()
   t.is(c.value, 0n)
@@ -93,3 +368,442 @@ test('ncchannels', t => {
   t.is(c.isFgDefault, false, 'fg not default')
   t.is(c.isBgDefault, true, 'bg default')
 })
+
+test('ncchannels pairs', t => {
+  const c = Channels.from(0, 0)
+  c.bgIdx = 4
+  c.fgRgb = 0x102030
+
+  const copy = Channels.from(c.value)
+  t.is(copy.fg, c.fg, 'bigint round trip')
+  t.is(copy.bg, c.bg)
+
+  const reversed = c.reverse
+  t.is(reversed.bgRgb, 0x102030, 'reversed')
+  t.is(reversed.fgIdx, 4)
+
+  const pairs = new Uint32Array(8)
+  Channels.setRgb(pairs, 0xff8800, 'fg')
+  Channels.setPalindex(pairs, 7, 'bg')
+
+  const cell = Channels.from(pairs.subarray(2, 4))
+  t.is(cell.fgRgb, 0xff8800, 'bulk fg rgb')
+  t.is(cell.isFgRgb, true)
+  t.is(cell.bgIdx, 7, 'bulk bg palindex')
+  t.is(cell.isBgIndexed, true)
+
+  Channels.reverse(pairs)
+  t.is(Channels.from(pairs.subarray(6, 8)).bgRgb, 0xff8800, 'bulk reverse')
+})
+
+test('command buffer', t => {
+  const nc = new Notcurses()
+  const plane = new Plane(nc, { rows: 1, cols: 5 })
+
+  const cmds = new CommandBuffer(8) // force growth
+  cmds.setStyles(NCSTYLE_BOLD)
+  cmds.setChannels(Channels.from(0xff00ff, 0))
+  cmds.putstr('hel', 0, 0)
+  cmds.putstr('lo')
+
+  const count = plane.exec(cmds)
+  const text = plane.contents(0, 0)
+
+  cmds.reset()
+  cmds.putstr('out of bounds', 0, 0)
+  const failed = plane.exec(cmds)
+
+  cmds.reset()
+  cmds.erase()
+  cmds.erase()
+  cmds._buffer.writeUInt32LE(99, 4) // corrupt the second opcode
+  t.exception(() => plane.exec(cmds), /malformed op at index 1/)
+
+  nc.destroy()
+
+  t.is(count, 4)
+  t.is(text, 'hello')
+  t.is(failed, 0)
+})
+
+test('put cells', t => {
+  const nc = new Notcurses()
+  const plane = new Plane(nc, { rows: 2, cols: 3 })
+
+  const codepoints = new Uint32Array([...'abcdef'].map(c => c.codePointAt(0)))
+  const channels = new Uint32Array(12)
+  channels.fill(Channels.from(0xff00ff, 0).fg)
+
+  const written = plane.putCells(0, 0, 2, 3, codepoints, null, channels)
+  const text = plane.contents(0, 0)
+
+  nc.destroy()
+
+  t.is(written, 6)
+  t.is(text, 'abcdef')
+})
+
+test('request render past 1000fps', async t => {
+  let onframe
+  const frame = new Promise(resolve => { onframe = resolve })
+
+  const nc = new Notcurses({ sink: 'memory', onframe })
+
+  nc.setMaxFps(Infinity)
+  nc.requestRender()
+
+  const status = await frame
+
+  nc.destroy()
+
+  t.is(status, 0)
+})
+
+test('request render during stdplane render', async t => {
+  let onframe
+  const frame = new Promise(resolve => { onframe = resolve })
+
+  const nc = new Notcurses({ sink: 'memory', onframe })
+
+  const rendering = nc.stdplane.renderAsync()
+  nc.requestRender()
+
+  await rendering
+  const status = await frame
+
+  nc.destroy()
+
+  t.is(status, 0)
+})
+
+test('render stats', t => {
+  const nc = new Notcurses()
+
+  nc.render()
+  nc.render()
+  const stats = nc.resetStats()
+
+  const values = new Float64Array(Notcurses.STATS_FIELDS.length)
+  nc.stats(values)
+
+  nc.destroy()
+
+  t.ok(stats.renders >= 2, 'renders counted')
+  t.is(values[Notcurses.STATS_FIELDS.indexOf('renders')], 0, 'reset')
+})
+
+test('memory sink', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+
+  nc.readOutput() // discard init sequences
+
+  const plane = new Plane(nc, { rows: 1, cols: 5 })
+  plane.putstr('hello', 0, 0)
+  nc.render()
+
+  const frame = nc.readOutput()
+
+  nc.destroy()
+
+  t.ok(frame.toString().includes('hello'), 'frame captured')
+})
+
+test('render to buffer', t => {
+  const nc = new Notcurses()
+
+  const plane = new Plane(nc, { rows: 1, cols: 5 })
+  plane.putstr('hello', 0, 0)
+
+  const target = Buffer.alloc(4)
+  const frame = nc.renderToBuffer(target) // too small, reallocated
+
+  plane.putstr('world', 0, 0)
+  const big = Buffer.alloc(64 * 1024)
+  const next = nc.renderToBuffer(big)
+
+  nc.destroy()
+
+  t.ok(frame.toString().includes('hello'))
+  t.is(next.buffer, big.buffer, 'reused target')
+  t.ok(next.toString().includes('world'))
+})
+
+test('piles', async t => {
+  const nc = new Notcurses()
+
+  const a = Plane.pile(nc, { name: 'a', rows: 2, cols: 10 })
+  const b = Plane.pile(nc, { rows: 2, cols: 10 })
+  a.putstr('pile a', 0, 0)
+  b.putstr('pile b', 0, 0)
+
+  await nc.renderPiles([a, b])
+
+  const frameA = a.rasterizeToBuffer().toString()
+  const frameB = b.rasterizeToBuffer().toString()
+  const top = a.pileTop.name
+  const same = a.pileTop === a && a.pileBottom === a
+
+  nc.destroy()
+
+  t.ok(frameA.includes('pile a'))
+  t.ok(frameB.includes('pile b'))
+  t.is(top, 'a')
+  t.ok(same, 'existing wrapper')
+})
+
+test('pile render in flight', async t => {
+  const nc = new Notcurses()
+
+  const pile = Plane.pile(nc, { rows: 2, cols: 10 })
+  const child = new Plane(pile, { rows: 1, cols: 4 })
+
+  const rendering = pile.renderAsync()
+
+  await t.exception(child.renderAsync(), /render in flight/, 'same pile through another plane')
+  await t.exception(pile.pileTop.renderAsync(), /render in flight/, 'same pile through pileTop')
+  t.exception(() => nc.render(), /render in flight/)
+  t.exception(() => nc.destroy(), /render in flight/)
+  t.is(nc.rendering, true)
+
+  await rendering
+
+  t.is(nc.rendering, false)
+  nc.destroy()
+})
+
+test('visual formats', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+  const plane = new Plane(nc, { rows: 1, cols: 2 })
+
+  // 2x1 pixels, red then blue, rows padded to an 8 byte stride where noted
+  const visuals = {
+    rgba: new Visual(nc, Uint8Array.of(0xff, 0, 0, 0xff, 0, 0, 0xff, 0xff), 2, 1),
+    rgb: new Visual(nc, Uint8Array.of(0xff, 0, 0, 0, 0, 0xff, 0, 0), 2, 1, { format: 'rgb', stride: 8 }),
+    bgra: new Visual(nc, Uint8Array.of(0, 0, 0xff, 0xff, 0xff, 0, 0, 0xff), 2, 1, { format: 'bgra' }),
+    palidx: new Visual(nc, Uint8Array.of(1, 0, 0, 0, 0, 0, 0, 0), 2, 1, {
+      format: 'palidx',
+      stride: 8,
+      palette: Uint32Array.of(0x0000ff, 0xff0000)
+    })
+  }
+
+  const colors = {}
+  const snap = {}
+
+  for (const [format, visual] of Object.entries(visuals)) {
+    plane.erase()
+    visual.blit(plane, NCSCALE_NONE, NCBLIT_1x1)
+    plane.snapshot(snap)
+
+    // channels are [bg, fg] per cell, 1x1 blits paint the background
+    colors[format] = [snap.channels[0] & 0xffffff, snap.channels[2] & 0xffffff]
+
+    visual.destroy()
+  }
+
+  nc.destroy()
+
+  for (const format of Object.keys(visuals)) {
+    t.alike(colors[format], [0xff0000, 0x0000ff], format)
+  }
+})
+
+test('visual palette validation', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+  const pixels = Uint8Array.of(0, 2)
+
+  t.exception(() => new Visual(nc, pixels, 2, 1, { format: 'palidx', palette: new Uint32Array(0) }), /palette entries/)
+  t.exception(() => new Visual(nc, pixels, 2, 1, { format: 'palidx', palette: Uint32Array.of(0, 1) }), /out of range/)
+
+  const visual = new Visual(nc, Uint8Array.of(0, 1), 2, 1, { format: 'palidx', palette: Uint32Array.of(0, 1) })
+  t.exception(() => visual.update(pixels), /palette index out of range/, 'same check as create')
+  visual.update(pixels, Uint32Array.of(0, 1, 2))
+
+  visual.destroy()
+  nc.destroy()
+})
+
+test('visual update', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+  const plane = new Plane(nc, { rows: 1, cols: 1 })
+
+  const pixels = Uint8Array.of(0xff, 0, 0, 0xff)
+  const visual = new Visual(nc, pixels, 1, 1)
+  visual.blit(plane, NCSCALE_NONE, NCBLIT_1x1)
+
+  pixels.set([0, 0xff, 0, 0xff])
+  visual.update(pixels)
+  visual.blit()
+
+  const snap = plane.snapshot()
+  const color = snap.channels[0] & 0xffffff
+
+  visual.destroy()
+  nc.destroy()
+
+  t.is(color, 0x00ff00)
+})
+
+test('blit in flight', async t => {
+  const nc = new Notcurses({ sink: 'memory' })
+  const parent = new Plane(nc, { rows: 4, cols: 4 })
+  const plane = new Plane(parent, { rows: 2, cols: 2 })
+
+  const visual = new Visual(nc, new Uint8Array(4 * 4 * 4).fill(0xff), 4, 4)
+  const blitting = visual.blitAsync(plane, NCSCALE_STRETCH, NCBLIT_1x1)
+
+  t.exception(() => plane.destroy(), /blit in flight/)
+  t.exception(() => parent.destroy(true), /blit in flight/, 'ancestor family')
+  t.exception(() => nc.destroy(), /blit in flight/)
+
+  await blitting
+
+  visual.destroy()
+  plane.destroy()
+  nc.destroy()
+})
+
+test('downscale matches scalar box filter', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+  const plane = new Plane(nc, { rows: 20, cols: 5 })
+
+  // odd sizes, boxes span 12 columns so the vector paths engage
+  const w = 61
+  const h = 250
+  const pixels = new Uint8Array(w * h * 4)
+  for (let i = 0; i < pixels.length; i++) pixels[i] = (i * 131 + (i >> 7)) & 0xff
+  for (let i = 3; i < pixels.length; i += 4) pixels[i] = 0xff
+
+  const visual = new Visual(nc, pixels, w, h, { scaleTo: plane, blitter: NCBLIT_1x1 })
+  visual.blit(plane, NCSCALE_NONE, NCBLIT_1x1)
+
+  const snap = plane.snapshot()
+
+  // same geometry as scaleGeom() with 1x1 cells
+  const ratio = Math.max(5 / w, 20 / h)
+  const dw = Math.ceil(w * ratio)
+  const dh = Math.ceil(h * ratio)
+
+  const mismatches = []
+
+  for (let dy = 0; dy < 20; dy++) {
+    const y0 = Math.floor(dy * h / dh)
+    const y1 = Math.max(y0 + 1, Math.floor((dy + 1) * h / dh))
+
+    for (let dx = 0; dx < dw; dx++) {
+      const x0 = Math.floor(dx * w / dw)
+      const x1 = Math.max(x0 + 1, Math.floor((dx + 1) * w / dw))
+      const count = (x1 - x0) * (y1 - y0)
+      const sum = [0, 0, 0]
+
+      for (let y = y0; y < y1; y++) {
+        for (let x = x0; x < x1; x++) {
+          for (let c = 0; c < 3; c++) sum[c] += pixels[(y * w + x) * 4 + c]
+        }
+      }
+
+      const [r, g, b] = sum.map(v => Math.floor((v + Math.floor(count / 2)) / count))
+      const expected = (r << 16) | (g << 8) | b
+      const actual = snap.channels[(dy * 5 + dx) * 2] & 0xffffff
+
+      if (actual !== expected) mismatches.push([dy, dx, actual, expected])
+    }
+  }
+
+  visual.destroy()
+  nc.destroy()
+
+  t.is(dw, 5)
+  t.alike(mismatches, [])
+})
+
+test('bitmap cache', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+  const plane = new Plane(nc, { rows: 4, cols: 4 })
+
+  const pixels = new Uint8Array(8 * 8 * 4).fill(0xff)
+
+  const a = new Visual(nc, pixels, 8, 8)
+  const first = a.blitCached(plane, NCSCALE_STRETCH, NCBLIT_1x1)
+  a.destroy()
+
+  // same content from a new visual
+  const b = new Visual(nc, pixels, 8, 8)
+  const second = b.blitCached(plane, NCSCALE_STRETCH, NCBLIT_1x1)
+  b.destroy()
+
+  const { entries, hits, misses } = nc.bitmapCache
+
+  nc.destroy()
+
+  t.is(first, false, 'miss')
+  t.is(second, true, 'hit')
+  t.is(entries, 1)
+  t.is(hits, 1)
+  t.is(misses, 1)
+})
+
+test('bitmap cache shared content', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+  const a = new Plane(nc, { rows: 4, cols: 4 })
+  const b = new Plane(nc, { y: 4, rows: 4, cols: 4 })
+
+  const pixels = new Uint8Array(8 * 8 * 4).fill(0xff)
+  const visual = new Visual(nc, pixels, 8, 8)
+
+  const first = visual.blitCached(a, NCSCALE_STRETCH, NCBLIT_1x1)
+  const second = visual.blitCached(b, NCSCALE_STRETCH, NCBLIT_1x1)
+  const shown = nc.bitmapCache
+
+  // each plane keeps its own result, re-blitting reuses it in place
+  const again = visual.blitCached(a, NCSCALE_STRETCH, NCBLIT_1x1)
+  const reblit = visual.blitCached(b, NCSCALE_STRETCH, NCBLIT_1x1)
+  const { entries, hits, misses } = nc.bitmapCache
+
+  visual.destroy()
+  nc.destroy()
+
+  t.is(first, false)
+  t.is(second, false, 'not taken from the first plane')
+  t.is(shown.entries, 2)
+  t.is(again, true)
+  t.is(reblit, true)
+  t.is(entries, 2)
+  t.is(hits, 2)
+  t.is(misses, 2)
+})
+
+test('bitmap cache blit failure', t => {
+  const nc = new Notcurses({ sink: 'memory' })
+  const plane = new Plane(nc, { rows: 4, cols: 4 })
+
+  const visual = new Visual(nc, new Uint8Array(8 * 8 * 4).fill(0xff), 8, 8)
+
+  // the memory sink has no pixel support
+  t.exception(() => visual.blitCached(plane, NCSCALE_STRETCH, NCBLIT_PIXEL, NCVISUAL_OPTION_NODEGRADE), /blit failed/)
+  const { entries, misses } = nc.bitmapCache
+
+  visual.destroy()
+  nc.destroy()
+
+  t.is(entries, 0, 'nothing cached')
+  t.is(misses, 0)
+})
+
+test('png decode', async t => {
+  const nc = new Notcurses({ sink: 'memory' })
+
+  // 2x1 rgba: opaque red, half transparent blue
+  const png = Buffer.from('iVBORw0KGgoAAAANSUhEUgAAAAIAAAABCAYAAAD0In+KAAAADklEQVR4nGP4z8AAQg0AD3oDfnfpf5cAAAAASUVORK5CYII=', 'base64')
+
+  const visual = await Visual.fromPNG(nc, png)
+
+  t.is(visual.width, 2)
+  t.is(visual.height, 1)
+
+  visual.destroy()
+
+  await t.exception(Visual.fromPNG(nc, Buffer.from('not a png')), /malformed png/)
+
+  nc.destroy()
+})